@@ -0,0 +1,291 @@
+#ifndef SORT_TEMPLATE_H_
+#define SORT_TEMPLATE_H_
+/*
+ * Macro-generated sorts specialized for one element type and one comparison.
+ * Unlike qsort, the comparison is expanded in place, so the compiler can
+ * inline it and keep elements in registers.
+ *
+ * SORT_DEFINE(name, type, less) defines
+ *         static void name(type *arr, size_t len);
+ * where less(a, b) is an expression (usually a macro) that is true if and only
+ * if the element `a` has to come before the element `b`.
+ *
+ * SORT_DEFINE_CTX(name, type, ctx_type, less) defines
+ *         static void name(type *arr, size_t len, ctx_type ctx);
+ * where less(a, b, ctx) additionally receives `ctx`, e.g. a comparison
+ * function chosen at run time. `ctx_type` has to be a single identifier or a
+ * pointer to one, so typedef function pointer types first.
+ *
+ * The generated function is an introsort: median-of-three quick sort that
+ * falls back to heap sort when the recursion gets too deep and finishes small
+ * ranges with insertion sort. It is not stable.
+ *
+ * Example:
+ *         #define INT_LESS(a, b) ((a) < (b))
+ *         SORT_DEFINE(int_sort, int, INT_LESS)
+ *         ...
+ *         int_sort(arr, len);
+ *
+ * STRING_SORT_DEFINE(name, type, key) defines
+ *         static void name(type *arr, size_t len);
+ * which sorts elements by the C strings key(x) in the order of strcmp. It is
+ * a multikey quicksort: elements are partitioned three ways on one character
+ * at a time, so common prefixes are only scanned once instead of in every
+ * comparison.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+/* ranges no longer than this are finished off with insertion sort */
+#define SORT_TEMPLATE_INSERTION 16
+
+#define SORT_DEFINE_CTX(name, type, ctx_type, less)                           \
+                                                                              \
+static inline void name##_swap(type *arr, size_t i, size_t j)                 \
+{                                                                             \
+    type tmp = arr[i];                                                        \
+    arr[i] = arr[j];                                                          \
+    arr[j] = tmp;                                                             \
+}                                                                             \
+                                                                              \
+static inline void name##_insertion(type *arr, size_t len, ctx_type ctx)      \
+{                                                                             \
+    for (size_t i = 1; i < len; i++) {                                        \
+        type key = arr[i];                                                    \
+                                                                              \
+        size_t j;                                                             \
+        for (j = i; j > 0 && less(key, arr[j - 1], ctx); j--) {               \
+            arr[j] = arr[j - 1];                                              \
+        }                                                                     \
+                                                                              \
+        arr[j] = key;                                                         \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static inline void name##_sift_down(type *arr, size_t len, size_t i,          \
+                                    ctx_type ctx)                             \
+{                                                                             \
+    type x = arr[i];                                                          \
+                                                                              \
+    for (;;) {                                                                \
+        size_t child = 2 * i + 1;                                             \
+        if (child >= len) {                                                   \
+            break;                                                            \
+        }                                                                     \
+        if (child + 1 < len && less(arr[child], arr[child + 1], ctx)) {       \
+            child++;                                                          \
+        }                                                                     \
+        if (!less(x, arr[child], ctx)) {                                      \
+            break;                                                            \
+        }                                                                     \
+        arr[i] = arr[child];                                                  \
+        i = child;                                                            \
+    }                                                                         \
+                                                                              \
+    arr[i] = x;                                                               \
+}                                                                             \
+                                                                              \
+static inline void name##_heap(type *arr, size_t len, ctx_type ctx)           \
+{                                                                             \
+    for (size_t i = len / 2; i-- > 0;) {                                      \
+        name##_sift_down(arr, len, i, ctx);                                   \
+    }                                                                         \
+                                                                              \
+    for (size_t i = len - 1; i >= 1; i--) {                                   \
+        name##_swap(arr, 0, i);                                               \
+        name##_sift_down(arr, i, 0, ctx);                                     \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static inline size_t name##_median3(type *arr, size_t a, size_t b, size_t c,  \
+                                    ctx_type ctx)                             \
+{                                                                             \
+    if (less(arr[a], arr[b], ctx)) {                                          \
+        if (less(arr[b], arr[c], ctx)) {                                      \
+            return b;                                                         \
+        }                                                                     \
+        return less(arr[a], arr[c], ctx) ? c : a;                             \
+    } else {                                                                  \
+        if (less(arr[a], arr[c], ctx)) {                                      \
+            return a;                                                         \
+        }                                                                     \
+        return less(arr[b], arr[c], ctx) ? c : b;                             \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+/* partitions around arr[0]; scanning stops on keys equal to the pivot, so    \
+ * duplicates end up evenly split between both sides */                       \
+static inline size_t name##_partition(type *arr, size_t len, ctx_type ctx)    \
+{                                                                             \
+    size_t i = 0, j = len;                                                    \
+                                                                              \
+    for (;;) {                                                                \
+        while (less(arr[++i], arr[0], ctx)) {                                 \
+            if (i == len - 1) {                                               \
+                break;                                                        \
+            }                                                                 \
+        }                                                                     \
+        while (less(arr[0], arr[--j], ctx));                                  \
+        if (i >= j) {                                                         \
+            break;                                                            \
+        }                                                                     \
+        name##_swap(arr, i, j);                                               \
+    }                                                                         \
+                                                                              \
+    name##_swap(arr, 0, j);                                                   \
+    return j;                                                                 \
+}                                                                             \
+                                                                              \
+static void name##_impl(type *arr, size_t len, int depth_limit, ctx_type ctx) \
+{                                                                             \
+    while (len > SORT_TEMPLATE_INSERTION) {                                   \
+        if (depth_limit-- == 0) {                                             \
+            name##_heap(arr, len, ctx);                                       \
+            return;                                                           \
+        }                                                                     \
+                                                                              \
+        name##_swap(arr, 0,                                                   \
+                    name##_median3(arr, 1, len / 2, len - 1, ctx));           \
+        size_t p = name##_partition(arr, len, ctx);                           \
+                                                                              \
+        if (p < len - p - 1) {                                                \
+            name##_impl(arr, p, depth_limit, ctx);                            \
+            arr += p + 1;                                                     \
+            len -= p + 1;                                                     \
+        } else {                                                              \
+            name##_impl(arr + p + 1, len - p - 1, depth_limit, ctx);          \
+            len = p;                                                          \
+        }                                                                     \
+    }                                                                         \
+                                                                              \
+    name##_insertion(arr, len, ctx);                                          \
+}                                                                             \
+                                                                              \
+static void name(type *arr, size_t len, ctx_type ctx)                         \
+{                                                                             \
+    int depth_limit = 0;                                                      \
+    for (size_t n = len; n > 1; n >>= 1) {                                    \
+        depth_limit += 2;                                                     \
+    }                                                                         \
+                                                                              \
+    name##_impl(arr, len, depth_limit, ctx);                                  \
+}
+
+#define SORT_DEFINE(name, type, less)                                         \
+                                                                              \
+static inline int name##_less(type a, type b, int ctx)                        \
+{                                                                             \
+    (void) ctx;                                                               \
+    return less(a, b);                                                        \
+}                                                                             \
+                                                                              \
+SORT_DEFINE_CTX(name##_ctx, type, int, name##_less)                           \
+                                                                              \
+static void name(type *arr, size_t len)                                       \
+{                                                                             \
+    name##_ctx(arr, len, 0);                                                  \
+}
+
+/* string ranges no longer than this are finished off with insertion sort */
+#define STRING_SORT_INSERTION 12
+
+#define STRING_SORT_DEFINE(name, type, key)                                   \
+                                                                              \
+static inline void name##_swap(type *arr, size_t i, size_t j)                 \
+{                                                                             \
+    type tmp = arr[i];                                                        \
+    arr[i] = arr[j];                                                          \
+    arr[j] = tmp;                                                             \
+}                                                                             \
+                                                                              \
+/* the d-th character of the key, unsigned like strcmp compares them */       \
+static inline int name##_char(type x, size_t d)                               \
+{                                                                             \
+    return (unsigned char) (key(x))[d];                                       \
+}                                                                             \
+                                                                              \
+/* insertion sort on keys whose first d characters are known to be equal */   \
+static inline void name##_insertion(type *arr, size_t len, size_t d)          \
+{                                                                             \
+    for (size_t i = 1; i < len; i++) {                                        \
+        type x = arr[i];                                                      \
+                                                                              \
+        size_t j;                                                             \
+        for (j = i; j > 0 && strcmp((key(x)) + d, (key(arr[j - 1])) + d) < 0; \
+                j--) {                                                        \
+            arr[j] = arr[j - 1];                                              \
+        }                                                                     \
+                                                                              \
+        arr[j] = x;                                                           \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static inline size_t name##_median3(type *arr, size_t a, size_t b, size_t c,  \
+                                    size_t d)                                 \
+{                                                                             \
+    int ca = name##_char(arr[a], d);                                          \
+    int cb = name##_char(arr[b], d);                                          \
+    int cc = name##_char(arr[c], d);                                          \
+                                                                              \
+    if (ca < cb) {                                                            \
+        return cb < cc ? b : (ca < cc ? c : a);                               \
+    } else {                                                                  \
+        return ca < cc ? a : (cb < cc ? c : b);                               \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static void name##_impl(type *arr, size_t len, size_t d)                      \
+{                                                                             \
+    while (len > STRING_SORT_INSERTION) {                                     \
+        name##_swap(arr, 0, name##_median3(arr, 0, len / 2, len - 1, d));     \
+        int pivot = name##_char(arr[0], d);                                   \
+                                                                              \
+        /* three-way partition on the d-th character */                       \
+        size_t lt = 0, i = 1, gt = len;                                       \
+        while (i < gt) {                                                      \
+            int c = name##_char(arr[i], d);                                   \
+            if (c < pivot) {                                                  \
+                name##_swap(arr, lt++, i++);                                  \
+            } else if (c > pivot) {                                           \
+                name##_swap(arr, i, --gt);                                    \
+            } else {                                                          \
+                i++;                                                          \
+            }                                                                 \
+        }                                                                     \
+                                                                              \
+        /* Keys in the middle share one more character, unless all of them    \
+         * have ended and are sorted already. The largest of the three parts  \
+         * is looped on and the others, at most half as long, are recursed    \
+         * into, so the stack stays O(log len) deep however skewed they are.  \
+         */                                                                   \
+        size_t n_lt = lt, n_gt = len - gt;                                    \
+        size_t n_eq = pivot == 0 ? 0 : gt - lt;                               \
+                                                                              \
+        if (n_lt >= n_eq && n_lt >= n_gt) {                                   \
+            name##_impl(arr + lt, n_eq, d + 1);                               \
+            name##_impl(arr + gt, n_gt, d);                                   \
+            len = n_lt;                                                       \
+        } else if (n_gt >= n_eq) {                                            \
+            name##_impl(arr, n_lt, d);                                        \
+            name##_impl(arr + lt, n_eq, d + 1);                               \
+            arr += gt;                                                        \
+            len = n_gt;                                                       \
+        } else {                                                              \
+            name##_impl(arr, n_lt, d);                                        \
+            name##_impl(arr + gt, n_gt, d);                                   \
+            arr += lt;                                                        \
+            len = n_eq;                                                       \
+            d++;                                                              \
+        }                                                                     \
+    }                                                                         \
+                                                                              \
+    name##_insertion(arr, len, d);                                            \
+}                                                                             \
+                                                                              \
+static void name(type *arr, size_t len)                                       \
+{                                                                             \
+    name##_impl(arr, len, 0);                                                 \
+}
+
+#endif
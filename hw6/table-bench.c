@@ -0,0 +1,556 @@
+/* Benchmarks the table module: inserts n keys into an empty table, gets every
+ * one of them and as many keys that are not in the table, and removes them
+ * all again. The gets and removes go in a random order, so that keys with
+ * consecutive hashes are not also looked up in the order of their buckets.
+ * Prints the median time per operation of every phase as CSV.
+ *
+ * With --load, it times the gets alone instead, in tables of a fixed size that
+ * are filled to each of LOADS. With --groups, it replays the gets and inserts
+ * that groups -t makes on a data file and counts the calls to cmp. */
+
+#include "table.h"
+#include "hash.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdnoreturn.h>
+#include <time.h>
+
+struct config {
+    int n;              /* the number of keys */
+    int reps;           /* number of timed runs */
+    const char *table;  /* only run tables whose name contains this */
+    const char *keys;   /* only run key sets whose name contains this */
+    bool by_load;       /* time gets at every load of LOADS instead */
+    const char *groups; /* replay groups on this data file instead, or NULL */
+};
+
+/* the fractions of the buckets or slots filled by --load */
+static const double LOADS[] = {0.5, 0.75, 0.875};
+
+static const int N_LOADS = sizeof(LOADS) / sizeof(LOADS[0]);
+
+/* the phases of a run */
+enum phase {
+    PHASE_INSERT,
+    PHASE_GET_HIT,
+    PHASE_GET_MISS,
+    PHASE_REMOVE,
+    N_PHASES,
+};
+
+static const char *const PHASE_NAMES[N_PHASES] = {
+    [PHASE_INSERT] = "insert",
+    [PHASE_GET_HIT] = "get-hit",
+    [PHASE_GET_MISS] = "get-miss",
+    [PHASE_REMOVE] = "remove",
+};
+
+noreturn void usage(const char *name);
+
+void parse_args(int argc, char *argv[], struct config *c);
+
+/* make `n` random strings, each the number offset + i followed by random
+ * letters, so that no two keys are equal */
+char **make_random_keys(int n, int offset);
+
+/* make the strings "key<offset>", "key<offset + 1>", ... which differ only in
+ * their last few characters, the weak spot of string_hash */
+char **make_sequential_keys(int n, int offset);
+
+/* shuffle the first n keys in place */
+void shuffle_keys(char **keys, int n);
+
+void free_keys(char **keys, int n);
+
+double now_ns(void);
+
+/* Runs every phase c->reps times on a fresh table and writes the median time
+ * per operation of every phase to ns_per_op. `keys` are inserted in their
+ * order, and `hits` are the same keys in the order of the gets and removes;
+ * `misses` are never inserted. Returns false if the table returned a wrong
+ * value. */
+struct table_kind;
+struct key_set;
+
+bool time_table(struct config *c, struct table_kind *kind, char **keys,
+                char **hits, char **misses, double ns_per_op[N_PHASES]);
+
+/* Fills a table of `size` buckets or slots to `load` with keys and writes the
+ * median time per get of the inserted `keys` and of `misses` to *hit and
+ * *miss. Returns false if the table returned a wrong value. */
+bool time_load(struct config *c, struct table_kind *kind, int size,
+               double load, char **keys, char **misses, double *hit,
+               double *miss);
+
+/* run every table on one key set, either through all phases or by load */
+bool bench_phases(struct config *c, struct key_set *key_set);
+bool bench_loads(struct config *c, struct key_set *key_set);
+
+/* read the hometowns of a groups data file, the first field of every line,
+ * and store their number in *n */
+char **read_hometowns(const char *path, int *n);
+
+/* Runs every table through what groups -t does to its dictionary: a get of
+ * every hometown, followed by an insert if it is not there yet, in a table
+ * with the same hint. Prints the calls to cmp and the time per operation. */
+bool bench_groups(struct config *c);
+
+/* Create a table of exactly `size` buckets or slots, a power of two, or with
+ * no hint if size is 0, so that it grows through every size on the way. A
+ * TABLE_PRIME table gets the smallest of its primes from size on instead. */
+struct table *create_prime(int size);
+struct table *create_pow2(int size);
+struct table *create_robin_hood(int size);
+struct table *create_swiss(int size);
+
+struct table_kind {
+    const char *name;
+    struct table *(*create)(int size);
+    bool exact; /* whether create makes exactly `size` buckets or slots */
+};
+
+struct table_kind TABLES[] = {
+    {"prime", create_prime, false},
+    {"pow2", create_pow2, true},
+    {"robin-hood", create_robin_hood, true},
+    {"swiss", create_swiss, true},
+};
+
+int N_TABLES = sizeof(TABLES) / sizeof(TABLES[0]);
+
+struct key_set {
+    const char *name;
+    char **(*make)(int n, int offset);
+};
+
+struct key_set KEY_SETS[] = {
+    {"random", make_random_keys},
+    {"sequential", make_sequential_keys},
+};
+
+int N_KEY_SETS = sizeof(KEY_SETS) / sizeof(KEY_SETS[0]);
+
+int main(int argc, char *argv[])
+{
+    struct config c = {
+        .n = 1000000,
+        .reps = 5,
+        .table = "",
+        .keys = "",
+    };
+    parse_args(argc, argv, &c);
+
+    srand(time(NULL)); // seed the random-number generator
+
+    if (c.groups != NULL) {
+        return bench_groups(&c) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    bool ok = true;
+    if (c.by_load) {
+        printf("table,keys,size,load,reps,op,ns_per_op\n");
+    } else {
+        printf("table,keys,n,reps,op,ns_per_op\n");
+    }
+
+    for (int k = 0; k < N_KEY_SETS; k++) {
+        if (strstr(KEY_SETS[k].name, c.keys) == NULL) {
+            continue;
+        }
+
+        if (c.by_load) {
+            ok = bench_loads(&c, &KEY_SETS[k]) && ok;
+        } else {
+            ok = bench_phases(&c, &KEY_SETS[k]) && ok;
+        }
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+noreturn void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [options]\nOptions:\n", name);
+    fprintf(stderr, "\t-n N\t\tNumber of keys (default 1000000).\n");
+    fprintf(stderr, "\t--reps N\tTimed runs per measurement (default 5).\n");
+    fprintf(stderr, "\t--table NAME\tOnly run tables whose name contains "
+                    "NAME (prime, pow2, robin-hood, swiss).\n");
+    fprintf(stderr, "\t--keys NAME\tOnly run key sets whose name contains "
+                    "NAME (random, sequential).\n");
+    fprintf(stderr, "\t--load\t\tTime gets in tables of N buckets or slots, "
+                    "rounded up to a power of two, at 50%%, 75%% and 87.5%% "
+                    "load.\n");
+    fprintf(stderr, "\t--groups FILE\tReplay groups -t on the data FILE and "
+                    "count the calls to cmp.\n");
+    fprintf(stderr, "\t-h\t\tPrint this message.\n");
+    exit(EXIT_FAILURE);
+}
+
+void parse_args(int argc, char *argv[], struct config *c)
+{
+    for (int i = 1; i < argc; i++) {
+        /* whether an option taking a value has one */
+        bool has_value = i + 1 < argc;
+
+        if (strcmp(argv[i], "-n") == 0 && has_value) {
+            c->n = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--reps") == 0 && has_value) {
+            c->reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--table") == 0 && has_value) {
+            c->table = argv[++i];
+        } else if (strcmp(argv[i], "--keys") == 0 && has_value) {
+            c->keys = argv[++i];
+        } else if (strcmp(argv[i], "--load") == 0) {
+            c->by_load = true;
+        } else if (strcmp(argv[i], "--groups") == 0 && has_value) {
+            c->groups = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (c->n < 1 || c->reps < 1) {
+        usage(argv[0]);
+    }
+}
+
+bool bench_phases(struct config *c, struct key_set *key_set)
+{
+    bool ok = true;
+
+    char **keys = key_set->make(c->n, 0);
+    char **misses = key_set->make(c->n, c->n);
+    shuffle_keys(misses, c->n);
+
+    char **hits = malloc(c->n * sizeof(*hits));
+    memcpy(hits, keys, c->n * sizeof(*hits));
+    shuffle_keys(hits, c->n);
+
+    for (int s = 0; s < N_TABLES; s++) {
+        if (strstr(TABLES[s].name, c->table) == NULL) {
+            continue;
+        }
+
+        double ns_per_op[N_PHASES];
+        if (!time_table(c, &TABLES[s], keys, hits, misses, ns_per_op)) {
+            fprintf(stderr, "%s table BUG on %s keys!\n", TABLES[s].name,
+                    key_set->name);
+            ok = false;
+        }
+
+        for (int p = 0; p < N_PHASES; p++) {
+            printf("%s,%s,%d,%d,%s,%.3f\n", TABLES[s].name, key_set->name,
+                   c->n, c->reps, PHASE_NAMES[p], ns_per_op[p]);
+        }
+    }
+
+    free_keys(keys, c->n);
+    free_keys(misses, c->n);
+    free(hits);
+
+    return ok;
+}
+
+bool bench_loads(struct config *c, struct key_set *key_set)
+{
+    bool ok = true;
+
+    int size = 64;
+    while (size < c->n) {
+        size *= 2;
+    }
+
+    /* enough keys for the highest load */
+    char **keys = key_set->make(size, 0);
+    char **misses = key_set->make(size, size);
+    shuffle_keys(misses, size);
+
+    for (int s = 0; s < N_TABLES; s++) {
+        if (strstr(TABLES[s].name, c->table) == NULL || !TABLES[s].exact) {
+            continue;
+        }
+
+        for (int l = 0; l < N_LOADS; l++) {
+            double hit, miss;
+            if (!time_load(c, &TABLES[s], size, LOADS[l], keys, misses, &hit,
+                           &miss)) {
+                fprintf(stderr, "%s table BUG on %s keys!\n", TABLES[s].name,
+                        key_set->name);
+                ok = false;
+            }
+
+            printf("%s,%s,%d,%g,%d,get-hit,%.3f\n", TABLES[s].name,
+                   key_set->name, size, LOADS[l], c->reps, hit);
+            printf("%s,%s,%d,%g,%d,get-miss,%.3f\n", TABLES[s].name,
+                   key_set->name, size, LOADS[l], c->reps, miss);
+        }
+    }
+
+    free_keys(keys, size);
+    free_keys(misses, size);
+
+    return ok;
+}
+
+/* A hint is the number of pairs a table holds without growing: a chained
+ * table holds one per bucket, and an open-addressing one 7/8 of its slots */
+struct table *create_prime(int size)
+{
+    return table_create(size, string_cmp, string_hash);
+}
+
+struct table *create_pow2(int size)
+{
+    return table_create_sized(size, string_cmp, string_hash, TABLE_POW2);
+}
+
+struct table *create_robin_hood(int size)
+{
+    return table_create_layout(size / 8 * 7, string_cmp, string_hash,
+                               TABLE_ROBIN_HOOD);
+}
+
+struct table *create_swiss(int size)
+{
+    return table_create_layout(size / 8 * 7, string_cmp, string_hash,
+                               TABLE_SWISS);
+}
+
+char **make_random_keys(int n, int offset)
+{
+    char **keys = malloc(n * sizeof(*keys));
+
+    for (int i = 0; i < n; i++) {
+        char key[32];
+        int len = snprintf(key, sizeof(key), "%d", offset + i);
+        for (int j = 0; j < 16; j++) {
+            key[len++] = 'a' + rand() % 26;
+        }
+        key[len] = '\0';
+
+        keys[i] = strdup(key);
+    }
+
+    return keys;
+}
+
+char **make_sequential_keys(int n, int offset)
+{
+    char **keys = malloc(n * sizeof(*keys));
+
+    for (int i = 0; i < n; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "key%d", offset + i);
+        keys[i] = strdup(key);
+    }
+
+    return keys;
+}
+
+void shuffle_keys(char **keys, int n)
+{
+    for (int i = n - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        char *tmp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = tmp;
+    }
+}
+
+void free_keys(char **keys, int n)
+{
+    for (int i = 0; i < n; i++) {
+        free(keys[i]);
+    }
+    free(keys);
+}
+
+double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+bool time_table(struct config *c, struct table_kind *kind, char **keys,
+                char **hits, char **misses, double ns_per_op[N_PHASES])
+{
+    double *times[N_PHASES];
+    for (int p = 0; p < N_PHASES; p++) {
+        times[p] = malloc(c->reps * sizeof(double));
+    }
+
+    bool ok = true;
+
+    for (int r = 0; r < c->reps; r++) {
+        struct table *t = kind->create(0);
+
+        double start = now_ns();
+        for (int i = 0; i < c->n; i++) {
+            table_insert(t, keys[i], keys[i]);
+        }
+        times[PHASE_INSERT][r] = now_ns() - start;
+
+        start = now_ns();
+        for (int i = 0; i < c->n; i++) {
+            ok = table_get(t, hits[i]) == hits[i] && ok;
+        }
+        times[PHASE_GET_HIT][r] = now_ns() - start;
+
+        start = now_ns();
+        for (int i = 0; i < c->n; i++) {
+            ok = table_get(t, misses[i]) == NULL && ok;
+        }
+        times[PHASE_GET_MISS][r] = now_ns() - start;
+
+        start = now_ns();
+        for (int i = 0; i < c->n; i++) {
+            ok = table_remove(t, hits[i]) == hits[i] && ok;
+        }
+        times[PHASE_REMOVE][r] = now_ns() - start;
+
+        ok = table_length(t) == 0 && ok;
+        table_free(t);
+    }
+
+    for (int p = 0; p < N_PHASES; p++) {
+        qsort(times[p], c->reps, sizeof(double), cmp_double);
+        ns_per_op[p] = times[p][c->reps / 2] / c->n;
+        free(times[p]);
+    }
+
+    return ok;
+}
+
+bool time_load(struct config *c, struct table_kind *kind, int size,
+               double load, char **keys, char **misses, double *hit,
+               double *miss)
+{
+    int n = size * load;
+
+    char **hits = malloc(n * sizeof(*hits));
+    memcpy(hits, keys, n * sizeof(*hits));
+    shuffle_keys(hits, n);
+
+    double *hit_times = malloc(c->reps * sizeof(double));
+    double *miss_times = malloc(c->reps * sizeof(double));
+    bool ok = true;
+
+    struct table *t = kind->create(size);
+    for (int i = 0; i < n; i++) {
+        table_insert(t, keys[i], keys[i]);
+    }
+
+    for (int r = 0; r < c->reps; r++) {
+        double start = now_ns();
+        for (int i = 0; i < n; i++) {
+            ok = table_get(t, hits[i]) == hits[i] && ok;
+        }
+        hit_times[r] = now_ns() - start;
+
+        start = now_ns();
+        for (int i = 0; i < n; i++) {
+            ok = table_get(t, misses[i]) == NULL && ok;
+        }
+        miss_times[r] = now_ns() - start;
+    }
+
+    table_free(t);
+
+    qsort(hit_times, c->reps, sizeof(double), cmp_double);
+    qsort(miss_times, c->reps, sizeof(double), cmp_double);
+    *hit = hit_times[c->reps / 2] / n;
+    *miss = miss_times[c->reps / 2] / n;
+
+    free(hit_times);
+    free(miss_times);
+    free(hits);
+
+    return ok;
+}
+
+char **read_hometowns(const char *path, int *n)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    int cap = 1024;
+    char **hometowns = malloc(cap * sizeof(*hometowns));
+    *n = 0;
+
+    /* the record format of groups */
+    char hometown[32], fullname[64];
+    while (fscanf(file, "%31[^\t]\t%63[^\n]\n", hometown, fullname) == 2) {
+        if (*n == cap) {
+            cap *= 2;
+            hometowns = realloc(hometowns, cap * sizeof(*hometowns));
+        }
+        hometowns[(*n)++] = strdup(hometown);
+    }
+
+    fclose(file);
+    return hometowns;
+}
+
+bool bench_groups(struct config *c)
+{
+    int n;
+    char **hometowns = read_hometowns(c->groups, &n);
+    double *times = malloc(c->reps * sizeof(double));
+    bool ok = true;
+
+    printf("table,file,records,ops,cmp_calls,cmp_per_op,ns_per_op\n");
+
+    for (int s = 0; s < N_TABLES; s++) {
+        if (strstr(TABLES[s].name, c->table) == NULL) {
+            continue;
+        }
+
+        struct table_stats stats;
+        for (int r = 0; r < c->reps; r++) {
+            /* groups -t creates its table with a hint of 1024 */
+            struct table *t = TABLES[s].create(1024);
+
+            double start = now_ns();
+            for (int i = 0; i < n; i++) {
+                if (table_get(t, hometowns[i]) == NULL) {
+                    table_insert(t, hometowns[i], hometowns[i]);
+                }
+            }
+            times[r] = now_ns() - start;
+            /* the same in every run */
+            table_stats(t, &stats);
+
+            for (int i = 0; i < n; i++) {
+                ok = strcmp(table_get(t, hometowns[i]), hometowns[i]) == 0
+                    && ok;
+            }
+            table_free(t);
+        }
+
+        qsort(times, c->reps, sizeof(double), cmp_double);
+        printf("%s,%s,%d,%ld,%ld,%.3f,%.3f\n", TABLES[s].name, c->groups, n,
+               stats.ops, stats.cmp_calls,
+               (double) stats.cmp_calls / stats.ops, times[c->reps / 2] / n);
+    }
+
+    if (!ok) {
+        fprintf(stderr, "table BUG on %s!\n", c->groups);
+    }
+
+    free_keys(hometowns, n);
+    free(times);
+    return ok;
+}
@@ -143,6 +143,265 @@ static void large_insert(void)
     table_free(t);
 }
 
+static void count_pair(void *key, void *value, void *data)
+{
+    (void) key;
+    (void) value;
+    (*(int *) data)++;
+}
+
+/* the keys of a walk, in the order they were visited */
+struct walk {
+    char **keys;
+    int len;
+};
+
+static void record_key(void *key, void *value, void *data)
+{
+    (void) value;
+    struct walk *w = data;
+    w->keys[w->len++] = key;
+}
+
+/* walks a table with string keys that share prefixes, including the empty
+ * string and bytes above 127, and checks that they come in strcmp order */
+static void walk_order_table(struct table *t)
+{
+    static const char *const PREFIXES[] = {"", "a", "ab", "abab", "b"};
+    static const char ALPHABET[] = "ab\xe9";
+    const int n = 500;
+    char **strs = calloc(n, sizeof(*strs));
+
+    int length = 0;
+    for (int i = 0; i < n; i++) {
+        /* the first key is the empty string */
+        char str[16];
+        int len = snprintf(str, sizeof(str), "%s",
+                           i == 0 ? "" : PREFIXES[rand() % 5]);
+        for (int j = i == 0 ? 0 : rand() % 4; j > 0; j--) {
+            str[len++] = ALPHABET[rand() % 3];
+        }
+        str[len] = '\0';
+
+        strs[i] = strdup(str);
+        if (table_insert(t, strs[i], _p(i + 1)) == NULL) {
+            length++;
+        }
+    }
+    expect_eq(length, table_length(t));
+
+    struct walk w = { .keys = malloc(length * sizeof(char *)), .len = 0 };
+    table_walk(t, record_key, &w);
+    expect_eq(length, w.len);
+    expect_str(w.keys[0], "");
+    for (int i = 1; i < w.len; i++) {
+        expect_eq(1, strcmp(w.keys[i - 1], w.keys[i]) < 0);
+    }
+
+    free(w.keys);
+    for (int i = 0; i < n; i++) {
+        free(strs[i]);
+    }
+    free(strs);
+
+    table_free(t);
+}
+
+static void walk_order(void)
+{
+    walk_order_table(table_create(0, string_cmp, string_hash));
+}
+
+/* strcmp behind a function other than string_cmp, so that table_walk sorts
+ * with the generic sort instead of the radix sort for string keys */
+static int other_string_cmp(void *a, void *b)
+{
+    return strcmp(a, b);
+}
+
+static void walk_order_generic(void)
+{
+    walk_order_table(table_create(0, other_string_cmp, string_hash));
+}
+
+static void walk_order_robin_hood(void)
+{
+    walk_order_table(table_create_layout(0, string_cmp, string_hash,
+                                         TABLE_ROBIN_HOOD));
+}
+
+static void walk_order_swiss(void)
+{
+    walk_order_table(table_create_layout(0, string_cmp, string_hash,
+                                         TABLE_SWISS));
+}
+
+/* grows an empty table t from its smallest size through many resizes and
+ * shrinks it again, checking the keys while buckets are still being moved */
+static void grow_shrink_table(struct table *t)
+{
+    const int n = 100000;
+    char **strs = mk_random_strs(n);
+
+    for (int i = 0; i < n; i++) {
+        void *old = table_insert(t, strs[i], _p(i + 1));
+        expect_null(old);
+
+        if (i % 5000 == 0) {
+            for (int j = 0; j <= i; j++) {
+                expect_eq(j + 1, _i(table_get(t, strs[j])));
+            }
+        }
+    }
+    expect_eq(n, table_length(t));
+
+    int count = 0;
+    table_walk(t, count_pair, &count);
+    expect_eq(n, count);
+
+    /* keep every tenth key */
+    for (int i = 0; i < n; i++) {
+        if (i % 10 != 0) {
+            void *value = table_remove(t, strs[i]);
+            expect_eq(i + 1, _i(value));
+        }
+    }
+    expect_eq(n / 10, table_length(t));
+
+    for (int i = 0; i < n; i++) {
+        void *value = table_get(t, strs[i]);
+        if (i % 10 == 0) {
+            expect_eq(i + 1, _i(value));
+        } else {
+            expect_null(value);
+        }
+    }
+
+    count = 0;
+    table_walk(t, count_pair, &count);
+    expect_eq(n / 10, count);
+
+    for (int i = 0; i < n; i++) {
+        free(strs[i]);
+    }
+    free(strs);
+
+    table_free(t);
+}
+
+static void grow_shrink(void)
+{
+    grow_shrink_table(table_create(0, string_cmp, string_hash));
+}
+
+static void grow_shrink_pow2(void)
+{
+    grow_shrink_table(table_create_sized(0, string_cmp, string_hash,
+                                         TABLE_POW2));
+}
+
+static void grow_shrink_robin_hood(void)
+{
+    grow_shrink_table(table_create_layout(0, string_cmp, string_hash,
+                                          TABLE_ROBIN_HOOD));
+}
+
+static void grow_shrink_swiss(void)
+{
+    grow_shrink_table(table_create_layout(0, string_cmp, string_hash,
+                                          TABLE_SWISS));
+}
+
+/* removes and reinserts half of the keys over and over, which leaves deleted
+ * slots behind in a TABLE_SWISS table until it rehashes at the same size */
+static void swiss_churn(void)
+{
+    const int n = 2000;
+    char **strs = mk_random_strs(n);
+    struct table *t = table_create_layout(n, string_cmp, string_hash,
+                                          TABLE_SWISS);
+
+    for (int i = 0; i < n; i++) {
+        expect_null(table_insert(t, strs[i], _p(i + 1)));
+    }
+
+    for (int round = 0; round < 50; round++) {
+        for (int i = round % 2; i < n; i += 2) {
+            expect_eq(i + 1, _i(table_remove(t, strs[i])));
+        }
+        for (int i = round % 2; i < n; i += 2) {
+            expect_null(table_insert(t, strs[i], _p(i + 1)));
+        }
+        expect_eq(n, table_length(t));
+    }
+
+    for (int i = 0; i < n; i++) {
+        expect_eq(i + 1, _i(table_get(t, strs[i])));
+        free(strs[i]);
+    }
+    free(strs);
+
+    table_free(t);
+}
+
+/* With distinct hashes, cmp is called once per hit and never on a miss or an
+ * insert of a new key */
+static void cmp_calls_table(struct table *t)
+{
+    const int n = 1000;
+    char **strs = mk_random_strs(n);
+    char **misses = mk_random_strs(n);
+    struct table_stats stats;
+
+    for (int i = 0; i < n; i++) {
+        table_insert(t, strs[i], _p(i + 1));
+    }
+    table_stats(t, &stats);
+    expect_eq(n, stats.ops);
+    expect_eq(0, stats.cmp_calls);
+
+    for (int i = 0; i < n; i++) {
+        expect_eq(i + 1, _i(table_get(t, strs[i])));
+        expect_null(table_get(t, misses[i]));
+    }
+    table_stats(t, &stats);
+    expect_eq(3 * n, stats.ops);
+    expect_eq(n, stats.cmp_calls);
+
+    for (int i = 0; i < n; i++) {
+        expect_eq(i + 1, _i(table_remove(t, strs[i])));
+    }
+    table_stats(t, &stats);
+    expect_eq(4 * n, stats.ops);
+    expect_eq(2 * n, stats.cmp_calls);
+
+    for (int i = 0; i < n; i++) {
+        free(strs[i]);
+        free(misses[i]);
+    }
+    free(strs);
+    free(misses);
+
+    table_free(t);
+}
+
+static void cmp_calls(void)
+{
+    cmp_calls_table(table_create(0, string_cmp, string_hash));
+}
+
+static void cmp_calls_robin_hood(void)
+{
+    cmp_calls_table(table_create_layout(0, string_cmp, string_hash,
+                                        TABLE_ROBIN_HOOD));
+}
+
+static void cmp_calls_swiss(void)
+{
+    cmp_calls_table(table_create_layout(0, string_cmp, string_hash,
+                                        TABLE_SWISS));
+}
+
 /* these are a list of strings that will be hashed to 0 */
 static char *COLLISIONS[] = {
     "\xed\xf5\x7e\x79\x3b\xfa\x16\x0c\xb3\xaf\x3e\x5f\xf3\xef\x03\x84\x80\x58\x2e\xe2\xfb\x67\x32\xbb\xdf\xcb\x07\xd2\x5c\x2f\x1f\x1f",
@@ -268,6 +527,46 @@ static void remove_all_collision(void)
     table_free(t);
 }
 
+/* The colliding keys form one cluster of slots in an open-addressing table.
+ * Removing them one at a time from the middle shifts the rest back in a
+ * TABLE_ROBIN_HOOD table, and empties their slots in a TABLE_SWISS one. */
+static void open_collision(enum table_layout layout)
+{
+    struct table *t = table_create_layout(0, string_cmp, string_hash, layout);
+
+    for (int i = 0; i < N_COLLISIONS; i++) {
+        void *value = table_insert(t, COLLISIONS[i], _p(i));
+        expect_null(value);
+    }
+
+    for (int i = N_COLLISIONS / 2; i < N_COLLISIONS; i++) {
+        void *remove = table_remove(t, COLLISIONS[i]);
+        expect_eq(i, _i(remove));
+
+        for (int j = 0; j < N_COLLISIONS; j++) {
+            void *val = table_get(t, COLLISIONS[j]);
+            if (j < N_COLLISIONS / 2 || j > i) {
+                expect_eq(j, _i(val));
+            } else {
+                expect_null(val);
+            }
+        }
+    }
+    expect_eq(N_COLLISIONS / 2, table_length(t));
+
+    table_free(t);
+}
+
+static void robin_hood_collision(void)
+{
+    open_collision(TABLE_ROBIN_HOOD);
+}
+
+static void swiss_collision(void)
+{
+    open_collision(TABLE_SWISS);
+}
+
 struct unittest tests[] = {
     Test(new_free),
     Test(get_empty),
@@ -282,6 +581,20 @@ struct unittest tests[] = {
     Test(remove_mid_collision),
     Test(remove_all_collision),
     Test(large_insert),
+    Test(walk_order),
+    Test(walk_order_generic),
+    Test(walk_order_robin_hood),
+    Test(walk_order_swiss),
+    Test(grow_shrink),
+    Test(grow_shrink_pow2),
+    Test(grow_shrink_robin_hood),
+    Test(robin_hood_collision),
+    Test(grow_shrink_swiss),
+    Test(swiss_collision),
+    Test(swiss_churn),
+    Test(cmp_calls),
+    Test(cmp_calls_robin_hood),
+    Test(cmp_calls_swiss),
 };
 
 const int n_tests = sizeof(tests) / sizeof(tests[0]);
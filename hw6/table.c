@@ -1,76 +1,683 @@
 /* implementation of the table module */
 
 #include "table.h"
+#include "hash.h"
+#include "sort-template.h"
 
 #include <assert.h>
 #include <limits.h>
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
-/* a list of prime numbers for selecting the initial size */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* a list of prime numbers for the number of buckets of a TABLE_PRIME table.
+ * The table moves to the next one when it grows and to the previous one when
+ * it shrinks. */
 static const int PRIMES[] = {
-    73, 179, 283, 419, 811, 1663, 3259, 6481, 12893, 25667, 51263, INT_MAX,
+    73, 179, 283, 419, 811, 1663, 3259, 6481, 12893, 25667, 51263, 102533,
+    205069, 410141, 820319, 1640641, 3281293, 6562597, 13125209, 26250449,
+    52500901, 105001811, 210003643, 420007303, 840014627, 1680029257, INT_MAX,
 };
 
+/* the number of buckets of a TABLE_POW2 table is between 2^POW2_MIN_LOG and
+ * 2^POW2_MAX_LOG */
+#define POW2_MIN_LOG 6
+#define POW2_MAX_LOG 30
+
+/* 2^64 divided by the golden ratio, rounded to an odd number */
+#define FIBONACCI UINT64_C(0x9e3779b97f4a7c15)
+
+/* the table grows once it holds more than MAX_LOAD key-value pairs per bucket
+ * and shrinks once it holds fewer than one per MIN_LOAD_DIV buckets */
+#define MAX_LOAD 1
+#define MIN_LOAD_DIV 8
+
+/* the number of buckets that every operation moves while the table is being
+ * resized. Growing twofold takes as many inserts as the table has buckets, so
+ * any step of at least 1 finishes a resize before the next one is due. */
+#define REHASH_STEP 4
+
+/* an open-addressing table grows once more than MAX_FULL eighths of its slots
+ * are full, or in a TABLE_SWISS table, deleted. Probes get long quickly beyond
+ * that. It shrinks like a chained table. */
+#define MAX_FULL 7
+
 /* representation of buckets */
 struct bucket {
     void *key;
     void *value;
     struct bucket *next;
+    uint64_t hash; /* the hash of key, computed once when it is inserted */
+};
+
+/* a slot of an open-addressing table, empty if key is NULL */
+struct slot {
+    uint64_t hash;
+    void *key;
+    void *value;
 };
 
 /* internal representation of a table */
 struct table {
-    int size; /* the number of buckets in this table */
+    int size; /* the number of buckets or slots in this table */
+    enum table_layout layout;
+    /* always TABLE_POW2 for the open-addressing layouts, TABLE_ROBIN_HOOD
+     * and TABLE_SWISS */
+    enum table_sizing sizing;
+    int level; /* size is the level-th size of the sizing, from 0 */
     int length; /* the number of key-value pairs */
     int (*cmp)(void *, void *); /* comparison between two keys */
     uint64_t (*hash)(void *);   /* hash a key */
-    struct bucket *buckets[];   /* a variable array member for buckets */
+
+    /* the chains of a TABLE_CHAINED table, or the slots of an open-addressing
+     * one (TABLE_ROBIN_HOOD, TABLE_SWISS), which also has ctrl if it is
+     * TABLE_SWISS. The other array is NULL. */
+    struct bucket **buckets;
+    struct slot *slots;
+
+    long ops;       /* the number of gets, inserts and removes */
+    long cmp_calls; /* the number of calls to cmp made by them */
+
+    /* the control bytes of a TABLE_SWISS table, one per slot, and the number
+     * of them that are CTRL_DELETED. ctrl is NULL for other layouts. */
+    uint8_t *ctrl;
+    int tombstones;
+
+    /* While the table is being resized, the buckets old[moved..old_size)
+     * have not been moved into `buckets` yet, and a key whose bucket in `old`
+     * is one of them is found there. `old` is NULL otherwise. */
+    struct bucket **old;
+    int old_size;
+    int moved;
 };
 
 
+/* the number of buckets at a level of a sizing, 0 past the largest one */
+static int level_size(enum table_sizing sizing, int level)
+{
+    if (sizing == TABLE_POW2) {
+        int log = POW2_MIN_LOG + level;
+        return log <= POW2_MAX_LOG ? 1 << log : 0;
+    }
+
+    return PRIMES[level] != INT_MAX ? PRIMES[level] : 0;
+}
+
+/* the bucket of a hash among `size` buckets */
+static int bucket_index(struct table *t, uint64_t hash, int size)
+{
+    if (t->sizing == TABLE_POW2) {
+        /* the top log2(size) bits of the product */
+        return (hash * FIBONACCI) >> (64 - __builtin_ctz(size));
+    }
+
+    return hash % size;
+}
+
+/* The smallest level of a sizing whose size holds `hint` pairs without
+ * growing, given that a table grows once it holds more than `eighths` eighths
+ * of its size. It is the largest level if none does. */
+static int hint_level(enum table_sizing sizing, int hint, int eighths)
+{
+    int level = 0;
+    while (level_size(sizing, level + 1) != 0
+            && (int64_t) level_size(sizing, level) * eighths / 8 < hint) {
+        level++;
+    }
+
+    return level;
+}
+
 struct table *table_create(int hint,
         int (*cmp)(void *, void *),
         uint64_t (*hash)(void *key))
+{
+    return table_create_sized(hint, cmp, hash, TABLE_PRIME);
+}
+
+struct table *table_create_sized(int hint,
+        int (*cmp)(void *, void *),
+        uint64_t (*hash)(void *key),
+        enum table_sizing sizing)
 {
     assert(hint >= 0);
     assert(cmp != NULL && hash != NULL);
+    assert(sizing == TABLE_PRIME || sizing == TABLE_POW2);
 
-    /* Look for the first prime number in the list that is less than the hint
-     * since to minimize collision, the size of the table should be a prime
+    /* To minimize collisions, the size of a TABLE_PRIME table is a prime
      * number */
-    int i;
-    for (i = 1; PRIMES[i] < hint; i++);
-    int size = PRIMES[i - 1];
+    int level = hint_level(sizing, hint, 8 * MAX_LOAD);
 
-    /* Allocates all fields of the structure plus extra space for the buckets */
-    struct table *t = malloc(sizeof(*t) + size * sizeof(t->buckets[0]));
-    t->size = size;
+    struct table *t = malloc(sizeof(*t));
+    t->layout = TABLE_CHAINED;
+    t->sizing = sizing;
+    t->level = level;
+    t->size = level_size(sizing, level);
     t->length = 0;
     t->cmp = cmp;
     t->hash = hash;
+    t->buckets = calloc(t->size, sizeof(t->buckets[0]));
+    t->slots = NULL;
+    t->ctrl = NULL;
+    t->tombstones = 0;
+    t->ops = 0;
+    t->cmp_calls = 0;
+    t->old = NULL;
+    t->old_size = 0;
+    t->moved = 0;
+
+    return t;
+}
 
-    for (i = 0; i < size; i++) {
-        t->buckets[i] = NULL;
+/* the number of slots in a group of a TABLE_SWISS table */
+#define GROUP 16
+
+/* The control byte of a full slot is the 7-bit tag of its hash. Those of
+ * empty and deleted slots have the top bit set instead. */
+#define CTRL_EMPTY 0x80
+#define CTRL_DELETED 0xfe
+
+/* the control bytes of `size` empty slots, aligned for loading groups */
+static uint8_t *new_ctrl(int size)
+{
+    uint8_t *ctrl = aligned_alloc(GROUP, size);
+    memset(ctrl, CTRL_EMPTY, size);
+    return ctrl;
+}
+
+struct table *table_create_layout(int hint,
+        int (*cmp)(void *, void *),
+        uint64_t (*hash)(void *key),
+        enum table_layout layout)
+{
+    assert(layout == TABLE_CHAINED || layout == TABLE_ROBIN_HOOD
+            || layout == TABLE_SWISS);
+
+    if (layout == TABLE_CHAINED) {
+        return table_create_sized(hint, cmp, hash, TABLE_PRIME);
     }
 
+    assert(hint >= 0);
+    assert(cmp != NULL && hash != NULL);
+
+    int level = hint_level(TABLE_POW2, hint, MAX_FULL);
+
+    struct table *t = malloc(sizeof(*t));
+    t->layout = layout;
+    t->sizing = TABLE_POW2;
+    t->level = level;
+    t->size = level_size(TABLE_POW2, level);
+    t->length = 0;
+    t->cmp = cmp;
+    t->hash = hash;
+    t->buckets = NULL;
+    t->slots = calloc(t->size, sizeof(t->slots[0]));
+    t->ctrl = layout == TABLE_SWISS ? new_ctrl(t->size) : NULL;
+    t->tombstones = 0;
+    t->ops = 0;
+    t->cmp_calls = 0;
+    t->old = NULL;
+    t->old_size = 0;
+    t->moved = 0;
+
     return t;
 }
 
+/* moves the next REHASH_STEP buckets of a resize into the new array, and
+ * frees the old one once all of them have been moved */
+static void rehash_step(struct table *t)
+{
+    if (t->old == NULL) {
+        return;
+    }
+
+    for (int n = 0; n < REHASH_STEP && t->moved < t->old_size; n++) {
+        struct bucket *b = t->old[t->moved++];
+        while (b != NULL) {
+            struct bucket *next = b->next;
+            int idx = bucket_index(t, b->hash, t->size);
+            b->next = t->buckets[idx];
+            t->buckets[idx] = b;
+            b = next;
+        }
+    }
+
+    if (t->moved == t->old_size) {
+        free(t->old);
+        t->old = NULL;
+    }
+}
+
+/* starts resizing the table to the size at `level`. The pairs are moved by
+ * the following operations, a few buckets at a time. */
+static void resize(struct table *t, int level)
+{
+    /* a resize that is still going on is finished first */
+    while (t->old != NULL) {
+        rehash_step(t);
+    }
+
+    t->old = t->buckets;
+    t->old_size = t->size;
+    t->moved = 0;
+
+    t->level = level;
+    t->size = level_size(t->sizing, level);
+    t->buckets = calloc(t->size, sizeof(t->buckets[0]));
+}
+
+/* the chain that holds a key with this hash if it is in the table, and where
+ * it belongs if it is not */
+static struct bucket **chain(struct table *t, uint64_t hash)
+{
+    if (t->old != NULL) {
+        int idx = bucket_index(t, hash, t->old_size);
+        if (idx >= t->moved) {
+            return &t->old[idx];
+        }
+    }
+
+    return &t->buckets[bucket_index(t, hash, t->size)];
+}
+
+/* Whether `key`, whose hash is `hash`, equals a key of the table whose hash
+ * is `other_hash`. Keys with different hashes differ, so cmp, and with it a
+ * strcmp of a key that is likely not in the cache, is only called if the
+ * hashes are equal, which for a good hash means almost only on a hit. */
+static bool keys_equal(struct table *t, void *key, uint64_t hash, void *other,
+        uint64_t other_hash)
+{
+    if (hash != other_hash) {
+        return false;
+    }
+
+    t->cmp_calls++;
+    return t->cmp(key, other) == 0;
+}
+
+static void free_chains(struct bucket **buckets, int start, int end)
+{
+    for (int i = start; i < end; i++) {
+        struct bucket *b = buckets[i];
+        while (b != NULL) {
+            struct bucket *next = b->next;
+            free(b);
+            b = next;
+        }
+    }
+}
+
+/******************************************************************************/
+/*                     Open addressing (TABLE_ROBIN_HOOD)                     */
+/******************************************************************************/
+
+/* the slot where a pair with this hash is placed if it is free */
+static int home_slot(struct table *t, uint64_t hash)
+{
+    return bucket_index(t, hash, t->size);
+}
+
+/* how many slots past its home slot the pair in slot i is */
+static int slot_distance(struct table *t, int i)
+{
+    return (i - home_slot(t, t->slots[i].hash)) & (t->size - 1);
+}
+
+/* the index of the slot that holds `key`, or -1. The probe stops at the first
+ * slot whose pair is closer to home than `key` would be, since an insert of
+ * `key` would have taken that slot. */
+static int find_slot(struct table *t, void *key, uint64_t hash)
+{
+    int mask = t->size - 1;
+    int i = home_slot(t, hash);
+
+    for (int dist = 0; ; i = (i + 1) & mask, dist++) {
+        struct slot *s = &t->slots[i];
+        if (s->key == NULL || slot_distance(t, i) < dist) {
+            return -1;
+        }
+        if (keys_equal(t, key, hash, s->key, s->hash)) {
+            return i;
+        }
+    }
+}
+
+/* places a pair whose key is not in the table. Whenever it passes a pair that
+ * is closer to home than itself, the two swap and the displaced pair carries
+ * on looking for a slot. */
+static void place_slot(struct table *t, struct slot s)
+{
+    int mask = t->size - 1;
+    int i = home_slot(t, s.hash);
+
+    for (int dist = 0; ; i = (i + 1) & mask, dist++) {
+        struct slot *cur = &t->slots[i];
+        if (cur->key == NULL) {
+            *cur = s;
+            return;
+        }
+
+        int cur_dist = slot_distance(t, i);
+        if (cur_dist < dist) {
+            struct slot tmp = *cur;
+            *cur = s;
+            s = tmp;
+            dist = cur_dist;
+        }
+    }
+}
+
+/* moves every pair into a new array of slots of the size at `level`. Unlike
+ * the chains, this is done in one go: it is a linear scan over a flat array
+ * that allocates nothing per pair. */
+static void resize_slots(struct table *t, int level)
+{
+    struct slot *old = t->slots;
+    int old_size = t->size;
+
+    t->level = level;
+    t->size = level_size(TABLE_POW2, level);
+    t->slots = calloc(t->size, sizeof(t->slots[0]));
+
+    for (int i = 0; i < old_size; i++) {
+        if (old[i].key != NULL) {
+            place_slot(t, old[i]);
+        }
+    }
+
+    free(old);
+}
+
+static void *slots_get(struct table *t, void *key)
+{
+    int i = find_slot(t, key, t->hash(key));
+    return i >= 0 ? t->slots[i].value : NULL;
+}
+
+static void *slots_insert(struct table *t, void *key, void *value)
+{
+    uint64_t hash = t->hash(key);
+
+    int i = find_slot(t, key, hash);
+    if (i >= 0) {
+        void *old_value = t->slots[i].value;
+        t->slots[i].value = value;
+        return old_value;
+    }
+
+    if ((int64_t) (t->length + 1) * 8 > (int64_t) t->size * MAX_FULL
+            && level_size(TABLE_POW2, t->level + 1) != 0) {
+        resize_slots(t, t->level + 1);
+    }
+    /* a probe only ends at an empty slot, so one has to be left */
+    assert(t->length + 1 < t->size);
+
+    place_slot(t, (struct slot) {hash, key, value});
+    t->length++;
+
+    return NULL;
+}
+
+static void *slots_remove(struct table *t, void *key)
+{
+    int i = find_slot(t, key, t->hash(key));
+    if (i < 0) {
+        return NULL;
+    }
+
+    void *old_value = t->slots[i].value;
+
+    /* Backward-shift deletion: the pairs after the removed one move back a
+     * slot until one is empty or at home, which leaves every probe as if the
+     * removed pair had never been inserted */
+    int mask = t->size - 1;
+    for (int next = (i + 1) & mask;
+            t->slots[next].key != NULL && slot_distance(t, next) > 0;
+            next = (next + 1) & mask) {
+        t->slots[i] = t->slots[next];
+        i = next;
+    }
+    t->slots[i].key = NULL;
+    t->length--;
+
+    if (t->length < t->size / MIN_LOAD_DIV && t->level > 0) {
+        resize_slots(t, t->level - 1);
+    }
+
+    return old_value;
+}
+
+/******************************************************************************/
+/*                  Control bytes and SIMD probing (TABLE_SWISS)              */
+/******************************************************************************/
+
+/* Mixes the hash like bucket_index, and splits it into the group where the
+ * probe for it starts, from the top bits, and its tag, from the 7 bits below
+ * those. Groups are probed in the order g, g + 1, g + 3, g + 6, ... which
+ * visits every group as their number is a power of two. */
+static int first_group(struct table *t, uint64_t hash, uint8_t *tag)
+{
+    int log = __builtin_ctz(t->size / GROUP);
+    uint64_t mixed = hash * FIBONACCI;
+
+    *tag = (mixed >> (57 - log)) & 0x7f;
+    return mixed >> (64 - log);
+}
+
+/* the bit mask of the slots in a group whose control byte is c */
+static unsigned match_byte(const uint8_t *group, uint8_t c)
+{
+#if defined(__SSE2__)
+    __m128i bytes = _mm_load_si128((const __m128i *) group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char) c)));
+#else
+    unsigned mask = 0;
+    for (int i = 0; i < GROUP; i++) {
+        mask |= (unsigned) (group[i] == c) << i;
+    }
+    return mask;
+#endif
+}
+
+/* the bit mask of the slots in a group that are empty or deleted, i.e. whose
+ * control bytes have their top bit set */
+static unsigned match_free(const uint8_t *group)
+{
+#if defined(__SSE2__)
+    return _mm_movemask_epi8(_mm_load_si128((const __m128i *) group));
+#else
+    unsigned mask = 0;
+    for (int i = 0; i < GROUP; i++) {
+        mask |= (unsigned) (group[i] >> 7) << i;
+    }
+    return mask;
+#endif
+}
+
+/* the index of the slot that holds `key`, or -1 */
+static int find_group_slot(struct table *t, void *key, uint64_t hash)
+{
+    int mask = t->size / GROUP - 1;
+    uint8_t tag;
+    int g = first_group(t, hash, &tag);
+
+    for (int step = 1; ; g = (g + step++) & mask) {
+        const uint8_t *group = t->ctrl + g * GROUP;
+
+        for (unsigned m = match_byte(group, tag); m != 0; m &= m - 1) {
+            int i = g * GROUP + __builtin_ctz(m);
+            if (keys_equal(t, key, hash, t->slots[i].key, t->slots[i].hash)) {
+                return i;
+            }
+        }
+
+        /* an insert would have put key into the empty slot */
+        if (match_byte(group, CTRL_EMPTY) != 0) {
+            return -1;
+        }
+    }
+}
+
+/* places a pair whose key is not in the table into the first empty or
+ * deleted slot on its probe */
+static void place_group_slot(struct table *t, struct slot s)
+{
+    int mask = t->size / GROUP - 1;
+    uint8_t tag;
+    int g = first_group(t, s.hash, &tag);
+
+    for (int step = 1; ; g = (g + step++) & mask) {
+        unsigned avail = match_free(t->ctrl + g * GROUP);
+        if (avail != 0) {
+            int i = g * GROUP + __builtin_ctz(avail);
+            if (t->ctrl[i] == CTRL_DELETED) {
+                t->tombstones--;
+            }
+            t->ctrl[i] = tag;
+            t->slots[i] = s;
+            return;
+        }
+    }
+}
+
+/* moves every pair into new slots of the size at `level`, in one go like
+ * resize_slots. This also clears the tombstones. */
+static void resize_groups(struct table *t, int level)
+{
+    struct slot *old = t->slots;
+    int old_size = t->size;
+
+    free(t->ctrl);
+    t->level = level;
+    t->size = level_size(TABLE_POW2, level);
+    t->slots = calloc(t->size, sizeof(t->slots[0]));
+    t->ctrl = new_ctrl(t->size);
+    t->tombstones = 0;
+
+    for (int i = 0; i < old_size; i++) {
+        if (old[i].key != NULL) {
+            place_group_slot(t, old[i]);
+        }
+    }
+
+    free(old);
+}
+
+static void *groups_get(struct table *t, void *key)
+{
+    int i = find_group_slot(t, key, t->hash(key));
+    return i >= 0 ? t->slots[i].value : NULL;
+}
+
+static void *groups_insert(struct table *t, void *key, void *value)
+{
+    uint64_t hash = t->hash(key);
+
+    int i = find_group_slot(t, key, hash);
+    if (i >= 0) {
+        void *old_value = t->slots[i].value;
+        t->slots[i].value = value;
+        return old_value;
+    }
+
+    /* Tombstones count towards the load as probes go on past them. If they
+     * make up more than half of it, rehashing at the same size is enough. */
+    if ((int64_t) (t->length + t->tombstones + 1) * 8
+            > (int64_t) t->size * MAX_FULL) {
+        bool grow = (int64_t) (t->length + 1) * 16
+                > (int64_t) t->size * MAX_FULL;
+        if (grow && level_size(TABLE_POW2, t->level + 1) != 0) {
+            resize_groups(t, t->level + 1);
+        } else {
+            resize_groups(t, t->level);
+        }
+    }
+    /* a probe only ends at a group with an empty slot, so one has to be left */
+    assert(t->length + 1 < t->size);
+
+    place_group_slot(t, (struct slot) {hash, key, value});
+    t->length++;
+
+    return NULL;
+}
+
+static void *groups_remove(struct table *t, void *key)
+{
+    int i = find_group_slot(t, key, t->hash(key));
+    if (i < 0) {
+        return NULL;
+    }
+
+    void *old_value = t->slots[i].value;
+
+    /* Probes only go on past groups without an empty slot. If this group still
+     * has one, no probe has gone past it and the slot can be empty again;
+     * otherwise it is marked deleted so that probes carry on over it. */
+    if (match_byte(t->ctrl + i / GROUP * GROUP, CTRL_EMPTY) != 0) {
+        t->ctrl[i] = CTRL_EMPTY;
+    } else {
+        t->ctrl[i] = CTRL_DELETED;
+        t->tombstones++;
+    }
+    t->slots[i].key = NULL;
+    t->length--;
+
+    if (t->length < t->size / MIN_LOAD_DIV && t->level > 0) {
+        resize_groups(t, t->level - 1);
+    }
+
+    return old_value;
+}
+
 /******************************************************************************/
 /*                            Your Implementations                            */
 /******************************************************************************/
 
 void table_free(struct table *t)
 {
-    (void) t;
-    assert(0 && "TODO");
+    if (t->layout != TABLE_CHAINED) {
+        free(t->slots);
+        free(t->ctrl);
+        free(t);
+        return;
+    }
+
+    free_chains(t->buckets, 0, t->size);
+    if (t->old != NULL) {
+        free_chains(t->old, t->moved, t->old_size);
+        free(t->old);
+    }
+
+    free(t->buckets);
+    free(t);
 }
 
 void *table_get(struct table *t, void *key)
 {
     assert(t != NULL && key != NULL);
 
-    assert(0 && "TODO");
+    t->ops++;
+
+    if (t->layout == TABLE_ROBIN_HOOD) {
+        return slots_get(t, key);
+    }
+    if (t->layout == TABLE_SWISS) {
+        return groups_get(t, key);
+    }
+
+    rehash_step(t);
+
+    uint64_t hash = t->hash(key);
+    for (struct bucket *b = *chain(t, hash); b != NULL; b = b->next) {
+        if (keys_equal(t, key, hash, b->key, b->hash)) {
+            return b->value;
+        }
+    }
+
     return NULL;
 }
 
@@ -78,7 +685,40 @@ void *table_insert(struct table *t, void *key, void *value)
 {
     assert(t != NULL && key != NULL && value != NULL);
 
-    assert(0 && "TODO");
+    t->ops++;
+
+    if (t->layout == TABLE_ROBIN_HOOD) {
+        return slots_insert(t, key, value);
+    }
+    if (t->layout == TABLE_SWISS) {
+        return groups_insert(t, key, value);
+    }
+
+    rehash_step(t);
+
+    uint64_t hash = t->hash(key);
+    struct bucket **head = chain(t, hash);
+    for (struct bucket *b = *head; b != NULL; b = b->next) {
+        if (keys_equal(t, key, hash, b->key, b->hash)) {
+            void *old_value = b->value;
+            b->value = value;
+            return old_value;
+        }
+    }
+
+    struct bucket *b = malloc(sizeof(*b));
+    b->key = key;
+    b->value = value;
+    b->next = *head;
+    b->hash = hash;
+    *head = b;
+    t->length++;
+
+    if (t->length / MAX_LOAD > t->size
+            && level_size(t->sizing, t->level + 1) != 0) {
+        resize(t, t->level + 1);
+    }
+
     return NULL;
 }
 
@@ -90,16 +730,32 @@ void *table_remove(struct table *t, void *key)
 {
     assert(t != NULL && key != NULL);
 
-    int idx = t->hash(key) % t->size;
+    t->ops++;
+
+    if (t->layout == TABLE_ROBIN_HOOD) {
+        return slots_remove(t, key);
+    }
+    if (t->layout == TABLE_SWISS) {
+        return groups_remove(t, key);
+    }
+
+    rehash_step(t);
 
-    for (struct bucket **b_p = &t->buckets[idx]; *b_p != NULL;
+    uint64_t hash = t->hash(key);
+    for (struct bucket **b_p = chain(t, hash); *b_p != NULL;
             b_p = &(*b_p)->next) {
-        if (t->cmp(key, (*b_p)->key) == 0) {
+        if (keys_equal(t, key, hash, (*b_p)->key, (*b_p)->hash)) {
             void *old_value = (*b_p)->value;
             struct bucket *next = (*b_p)->next;
             free(*b_p);
             *b_p = next;
             t->length--;
+
+            /* shrinking waits for a resize that is still going on */
+            if (t->length < t->size / MIN_LOAD_DIV && t->level > 0
+                    && t->old == NULL) {
+                resize(t, t->level - 1);
+            }
             return old_value;
         }
     }
@@ -112,6 +768,12 @@ int table_length(struct table *t)
     return t->length;
 }
 
+void table_stats(struct table *t, struct table_stats *stats)
+{
+    stats->ops = t->ops;
+    stats->cmp_calls = t->cmp_calls;
+}
+
 static void print_kv(void *key, void *value, void *data)
 {
     FILE *fp = data;
@@ -123,24 +785,65 @@ void table_print(struct table *t, FILE *fp)
     table_walk(t, print_kv, fp);
 }
 
-static void quick_sort(struct bucket**arr, int len, int (*cmp)(void *, void *));
+typedef int (*key_cmp)(void *, void *);
+
+/* a key-value pair, copied out of a bucket or slot by table_walk */
+struct pair {
+    void *key;
+    void *value;
+};
+
+#define PAIR_LESS(a, b, cmp) ((cmp)((a).key, (b).key) < 0)
+
+/* sort_pairs: sorts an array of pairs by their keys */
+SORT_DEFINE_CTX(sort_pairs, struct pair, key_cmp, PAIR_LESS)
+
+#define PAIR_STRING(p) ((const char *) (p).key)
 
-static struct bucket **sorted_buckets(struct table *t)
+/* sort_string_pairs: sorts an array of pairs whose keys are C strings in the
+ * order of string_cmp, without calling it */
+STRING_SORT_DEFINE(sort_string_pairs, struct pair, PAIR_STRING)
+
+static void add_chains(struct pair *pairs, int *len, struct bucket **buckets,
+        int start, int end)
+{
+    for (int i = start; i < end; i++) {
+        for (struct bucket *b = buckets[i]; b != NULL; b = b->next) {
+            pairs[(*len)++] = (struct pair) {b->key, b->value};
+        }
+    }
+}
+
+static struct pair *sorted_pairs(struct table *t)
 {
     int length = table_length(t);
 
-    struct bucket **buckets = malloc(length * sizeof(struct bucket *));
+    struct pair *pairs = malloc(length * sizeof(struct pair));
     int len = 0;
-    for (int i = 0; i < t->size; i++) {
-        for (struct bucket *b = t->buckets[i]; b != NULL; b = b->next) {
-            buckets[len++] = b;
+    if (t->layout != TABLE_CHAINED) {
+        for (int i = 0; i < t->size; i++) {
+            if (t->slots[i].key != NULL) {
+                pairs[len++] = (struct pair) {t->slots[i].key,
+                                              t->slots[i].value};
+            }
+        }
+    } else {
+        add_chains(pairs, &len, t->buckets, 0, t->size);
+        if (t->old != NULL) {
+            add_chains(pairs, &len, t->old, t->moved, t->old_size);
         }
     }
 
     assert(length == len);
-    quick_sort(buckets, len, t->cmp);
+    /* String keys are radix sorted rather than compared over and over again
+     * from their first character */
+    if (t->cmp == string_cmp) {
+        sort_string_pairs(pairs, len);
+    } else {
+        sort_pairs(pairs, len, t->cmp);
+    }
 
-    return buckets;
+    return pairs;
 }
 
 void table_walk(struct table *t,
@@ -149,59 +852,12 @@ void table_walk(struct table *t,
 {
     assert(t != NULL && visit != NULL);
 
-    struct bucket **buckets = sorted_buckets(t);
+    struct pair *pairs = sorted_pairs(t);
     int length = table_length(t);
 
     for (int i = 0; i < length; i++) {
-        struct bucket *b = buckets[i];
-        visit(b->key, b->value, data);
+        visit(pairs[i].key, pairs[i].value, data);
     }
 
-    free(buckets);
+    free(pairs);
 }
-
-/******************************************************************************/
-/*                        Implementation of quick sort                        */
-/******************************************************************************/
-
-static inline void swap(struct bucket **arr, int i, int j)
-{
-    struct bucket *tmp = arr[i];
-    arr[i] = arr[j];
-    arr[j] = tmp;
-}
-
-static int partition(struct bucket **arr, int start, int end,
-                     int (*cmp)(void *, void *))
-{
-    struct bucket *pivot = arr[start];
-    int next = end - 1;
-
-    for (int i = end - 1; i > start; i--) {
-        if (cmp(arr[i]->key, pivot->key) > 0) {
-            swap(arr, next--, i);
-        }
-    }
-
-    swap(arr, start, next);
-    return next;
-}
-
-static void quick_sort_impl(struct bucket **arr, int start, int end,
-        int (*cmp)(void *, void *))
-{
-    if (end - start <= 1) {
-        return;
-    }
-
-    int p = partition(arr, start, end, cmp);
-
-    quick_sort_impl(arr, start, p, cmp);
-    quick_sort_impl(arr, p + 1, end, cmp);
-}
-
-static void quick_sort(struct bucket **arr, int len, int (*cmp)(void *, void *))
-{
-    quick_sort_impl(arr, 0, len, cmp);
-}
-
@@ -9,7 +9,9 @@ struct table;
 
 /* table_create: create a new table
  *
- * hint_size: the expected size of this table
+ * hint_size: the expected size of this table. The table starts out large
+ *            enough to hold this many key-value pairs without growing; this
+ *            is what the hint means for every constructor.
  * eq: equality function. Should return zero if two keys are the same and
  *     non-zero otherwise.
  * hash: calculate the hash of a given key
@@ -19,6 +21,66 @@ struct table *table_create(int hint_size,
                 int (*cmp)(void *, void *),
                 uint64_t (*hash)(void *key));
 
+/* how a table maps the hash of a key to one of its buckets */
+enum table_sizing {
+    /* a prime number of buckets, indexed by hash % size */
+    TABLE_PRIME,
+    /* a power of two number of buckets, indexed by the top bits of
+     * hash * 2^64 / phi (Fibonacci hashing). There is no division, and the
+     * multiplication mixes every bit of the hash into the index, so that weak
+     * hash functions still spread the keys well. */
+    TABLE_POW2,
+};
+
+/* table_create_sized: create a new table with the given sizing; table_create
+ * creates a TABLE_PRIME one
+ *
+ * hint_size: the expected size of this table, as for table_create
+ * eq: equality function, as for table_create
+ * hash: calculate the hash of a given key
+ * sizing: how hashes are mapped to buckets
+ * return: pointer to newly created map.
+ */
+struct table *table_create_sized(int hint_size,
+                int (*cmp)(void *, void *),
+                uint64_t (*hash)(void *key),
+                enum table_sizing sizing);
+
+/* how a table stores its key-value pairs */
+enum table_layout {
+    /* a node of its own for every pair, chained to the others in its bucket */
+    TABLE_CHAINED,
+    /* open addressing: the pairs and their hashes sit in one flat array of
+     * slots, a power of two of them indexed like TABLE_POW2. A pair that
+     * collides goes to the next slot, and on the way takes the slot of any
+     * pair that is closer to its own home slot (Robin Hood hashing), which
+     * keeps the probes of every key short and lets misses stop early. Removed
+     * pairs leave no tombstones: the pairs after them shift back instead. */
+    TABLE_ROBIN_HOOD,
+    /* open addressing in the style of Swiss tables: the slots come in groups
+     * of 16, and a separate array holds a control byte per slot with 7 bits
+     * of the hash of its key. A probe compares the control bytes of a whole
+     * group at once with SSE2 and calls cmp only on slots whose bits match,
+     * and it moves on to another group only if the group has no empty slot. */
+    TABLE_SWISS,
+};
+
+/* table_create_layout: create a new table with the given layout; table_create
+ * creates a TABLE_CHAINED one. A TABLE_CHAINED table made here is the same as
+ * one made by table_create, i.e. TABLE_PRIME; use table_create_sized for a
+ * chained TABLE_POW2 one. The open-addressing layouts are always TABLE_POW2.
+ *
+ * hint_size: the expected size of this table, as for table_create
+ * eq: equality function, as for table_create
+ * hash: calculate the hash of a given key
+ * layout: how the pairs are stored
+ * return: pointer to newly created map.
+ */
+struct table *table_create_layout(int hint_size,
+                int (*cmp)(void *, void *),
+                uint64_t (*hash)(void *key),
+                enum table_layout layout);
+
 /* table_free: frees a table
  *
  * t: table to be freed.
@@ -68,6 +130,21 @@ void table_print(struct table *t, FILE *fp);
  */
 int table_length(struct table *t);
 
+/* counters of a table since it was created */
+struct table_stats {
+    long ops;       /* calls to table_get, table_insert and table_remove */
+    long cmp_calls; /* calls to cmp made by them */
+};
+
+/* table_stats: get how often the table has called cmp. A table keeps the hash
+ * of every key and calls cmp only on keys whose hash equals the one looked
+ * up, so on a good hash, cmp_calls is close to the number of hits.
+ *
+ * t: pointer to the table
+ * stats: where to write the counters
+ */
+void table_stats(struct table *t, struct table_stats *stats);
+
 /* table_walk: applies the visit function to each key-value pair in ascending
  * order of the keys.
  *
@@ -0,0 +1,402 @@
+/*
+ * extsort: sorts a binary file of native-endian 32-bit ints that may be
+ * larger than memory.
+ *
+ * 1. Run formation: the input is read in chunks that fit the memory budget,
+ *    each chunk is sorted with radix_sort, and written to a temporary file.
+ * 2. Merging: runs are k-way merged with a loser tree through large buffers.
+ *    If there are more runs than buffers that fit the budget, groups of runs
+ *    are merged into longer runs first.
+ *
+ * Throughput of each phase is reported on stderr.
+ */
+#include "sort.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdnoreturn.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* the smallest buffer given to a run while merging */
+#define MIN_MERGE_BUF (1 << 20)
+
+struct config {
+    size_t budget;      /* bytes of memory to use */
+    const char *tmpdir; /* where runs are spilled */
+    const char *input;
+    const char *output;
+};
+
+/* a sorted run being read during a merge */
+struct run {
+    int fd;
+    int *buf;
+    size_t cap; /* capacity of buf, in ints */
+    size_t pos; /* next int in buf */
+    size_t len; /* number of valid ints in buf */
+};
+
+/* A loser tree over k runs: every internal node holds the run that lost the
+ * match played there, and tree[0] holds the overall winner. Replacing the
+ * winner only replays the matches on its path to the root. */
+struct loser_tree {
+    int k;
+    int *tree;
+    int64_t *keys; /* the current head of every run, INT64_MAX once empty */
+};
+
+noreturn void usage(const char *name);
+
+void parse_args(int argc, char *argv[], struct config *c);
+
+noreturn void die(const char *what);
+
+/* read up to n bytes, retrying short reads; returns the number of bytes read,
+ * which is less than n only at the end of the file */
+size_t read_all(int fd, void *buf, size_t n);
+
+void write_all(int fd, const void *buf, size_t n);
+
+/* create an anonymous temporary file in dir */
+int make_temp(const char *dir);
+
+/* sort chunks of the input into runs; returns the number of runs */
+int form_runs(struct config *c, int in_fd, int **fds_p);
+
+/* merge the runs in fds[0..k) into out_fd using `budget` bytes of buffers */
+void merge_runs(int *fds, int k, int out_fd, size_t budget);
+
+double seconds_since(struct timespec *start);
+
+void report(const char *phase, off_t bytes, double secs);
+
+int main(int argc, char *argv[])
+{
+    struct config c = {
+        .budget = (size_t) 256 << 20,
+        .tmpdir = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp",
+    };
+    parse_args(argc, argv, &c);
+
+    int in_fd = open(c.input, O_RDONLY);
+    if (in_fd < 0) {
+        die(c.input);
+    }
+
+    struct stat st;
+    if (fstat(in_fd, &st) < 0) {
+        die(c.input);
+    }
+    if (st.st_size % sizeof(int) != 0) {
+        fprintf(stderr, "%s: size is not a multiple of %zu bytes\n", c.input,
+                sizeof(int));
+        exit(EXIT_FAILURE);
+    }
+
+    int *fds;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int n_runs = form_runs(&c, in_fd, &fds);
+    report("run formation", st.st_size, seconds_since(&start));
+    close(in_fd);
+
+    /* merge groups of runs into longer runs until all fit in one merge */
+    size_t max_fanin = c.budget / MIN_MERGE_BUF - 1;
+    if (max_fanin < 2) {
+        max_fanin = 2;
+    }
+
+    for (int pass = 1; (size_t) n_runs > max_fanin; pass++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        int n_merged = 0;
+        for (int i = 0; i < n_runs; i += max_fanin) {
+            int k = (size_t) (n_runs - i) < max_fanin ? n_runs - i
+                                                      : (int) max_fanin;
+            int fd = make_temp(c.tmpdir);
+            merge_runs(&fds[i], k, fd, c.budget);
+            fds[n_merged++] = fd;
+        }
+
+        char phase[64];
+        snprintf(phase, sizeof(phase), "merge pass %d (%d -> %d runs)", pass,
+                 n_runs, n_merged);
+        report(phase, st.st_size, seconds_since(&start));
+        n_runs = n_merged;
+    }
+
+    int out_fd = open(c.output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) {
+        die(c.output);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    merge_runs(fds, n_runs, out_fd, c.budget);
+    char phase[64];
+    snprintf(phase, sizeof(phase), "final merge (%d runs)", n_runs);
+    report(phase, st.st_size, seconds_since(&start));
+
+    if (close(out_fd) < 0) {
+        die(c.output);
+    }
+
+    free(fds);
+    return EXIT_SUCCESS;
+}
+
+noreturn void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [options] <input> <output>\n", name);
+    fprintf(stderr, "Sorts a binary file of 32-bit ints.\nOptions:\n");
+    fprintf(stderr, "\t--memory MB\tMemory budget in megabytes "
+                    "(default 256).\n");
+    fprintf(stderr, "\t--tmpdir DIR\tDirectory for temporary runs "
+                    "(default $TMPDIR or /tmp).\n");
+    fprintf(stderr, "\t-h\t\tPrint this message.\n");
+    exit(EXIT_FAILURE);
+}
+
+void parse_args(int argc, char *argv[], struct config *c)
+{
+    int i;
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        bool has_value = i + 1 < argc;
+
+        if (strcmp(argv[i], "--memory") == 0 && has_value) {
+            c->budget = (size_t) atol(argv[++i]) << 20;
+        } else if (strcmp(argv[i], "--tmpdir") == 0 && has_value) {
+            c->tmpdir = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (argc - i != 2 || c->budget < 2 * MIN_MERGE_BUF) {
+        usage(argv[0]);
+    }
+
+    c->input = argv[i];
+    c->output = argv[i + 1];
+}
+
+noreturn void die(const char *what)
+{
+    perror(what);
+    exit(EXIT_FAILURE);
+}
+
+size_t read_all(int fd, void *buf, size_t n)
+{
+    size_t done = 0;
+
+    while (done < n) {
+        ssize_t r = read(fd, (char *) buf + done, n - done);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r < 0) {
+            die("read");
+        }
+        if (r == 0) {
+            break;
+        }
+        done += r;
+    }
+
+    return done;
+}
+
+void write_all(int fd, const void *buf, size_t n)
+{
+    size_t done = 0;
+
+    while (done < n) {
+        ssize_t w = write(fd, (const char *) buf + done, n - done);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w < 0) {
+            die("write");
+        }
+        done += w;
+    }
+}
+
+int make_temp(const char *dir)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/extsort-XXXXXX", dir);
+
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        die(path);
+    }
+
+    /* the file goes away as soon as it is closed */
+    unlink(path);
+    return fd;
+}
+
+int form_runs(struct config *c, int in_fd, int **fds_p)
+{
+    /* radix_sort needs a scratch buffer as large as the chunk itself */
+    size_t chunk_len = c->budget / (2 * sizeof(int));
+
+    int *chunk = malloc(chunk_len * sizeof(int));
+    int n_runs = 0, cap = 16;
+    int *fds = malloc(cap * sizeof(int));
+
+    for (;;) {
+        size_t n = read_all(in_fd, chunk, chunk_len * sizeof(int))
+            / sizeof(int);
+        if (n == 0 && n_runs > 0) {
+            break;
+        }
+
+        radix_sort_sz(chunk, n);
+
+        int fd = make_temp(c->tmpdir);
+        write_all(fd, chunk, n * sizeof(int));
+
+        if (n_runs == cap) {
+            cap *= 2;
+            fds = realloc(fds, cap * sizeof(int));
+        }
+        fds[n_runs++] = fd;
+
+        if (n < chunk_len) {
+            break;
+        }
+    }
+
+    free(chunk);
+    *fds_p = fds;
+    return n_runs;
+}
+
+/* refill the run's buffer if it is used up; returns false at the end */
+static bool run_fill(struct run *r)
+{
+    if (r->pos < r->len) {
+        return true;
+    }
+
+    r->len = read_all(r->fd, r->buf, r->cap * sizeof(int)) / sizeof(int);
+    r->pos = 0;
+    return r->len > 0;
+}
+
+static int64_t run_head(struct run *r)
+{
+    return run_fill(r) ? r->buf[r->pos] : INT64_MAX;
+}
+
+/* plays the matches below `node` and returns the winner */
+static int lt_build(struct loser_tree *lt, int node)
+{
+    if (node >= lt->k) {
+        return node - lt->k;
+    }
+
+    int left = lt_build(lt, 2 * node);
+    int right = lt_build(lt, 2 * node + 1);
+
+    if (lt->keys[left] <= lt->keys[right]) {
+        lt->tree[node] = right;
+        return left;
+    } else {
+        lt->tree[node] = left;
+        return right;
+    }
+}
+
+/* replays the matches from leaf i, whose key changed, up to the root */
+static void lt_replay(struct loser_tree *lt, int i)
+{
+    int winner = i;
+
+    for (int node = (i + lt->k) / 2; node > 0; node /= 2) {
+        if (lt->keys[lt->tree[node]] < lt->keys[winner]) {
+            int tmp = lt->tree[node];
+            lt->tree[node] = winner;
+            winner = tmp;
+        }
+    }
+
+    lt->tree[0] = winner;
+}
+
+void merge_runs(int *fds, int k, int out_fd, size_t budget)
+{
+    /* k input buffers and one output buffer share the budget */
+    size_t cap = budget / (k + 1) / sizeof(int);
+
+    struct run *runs = malloc(k * sizeof(*runs));
+    struct loser_tree lt = {
+        .k = k,
+        .tree = malloc(k * sizeof(int)),
+        .keys = malloc(k * sizeof(int64_t)),
+    };
+
+    for (int i = 0; i < k; i++) {
+        if (lseek(fds[i], 0, SEEK_SET) < 0) {
+            die("lseek");
+        }
+
+        runs[i] = (struct run) {
+            .fd = fds[i],
+            .buf = malloc(cap * sizeof(int)),
+            .cap = cap,
+        };
+        lt.keys[i] = run_head(&runs[i]);
+    }
+    lt.tree[0] = lt_build(&lt, 1);
+
+    int *out = malloc(cap * sizeof(int));
+    size_t n_out = 0;
+
+    while (lt.keys[lt.tree[0]] != INT64_MAX) {
+        int w = lt.tree[0];
+        out[n_out++] = (int) lt.keys[w];
+        if (n_out == cap) {
+            write_all(out_fd, out, n_out * sizeof(int));
+            n_out = 0;
+        }
+
+        runs[w].pos++;
+        lt.keys[w] = run_head(&runs[w]);
+        lt_replay(&lt, w);
+    }
+    write_all(out_fd, out, n_out * sizeof(int));
+
+    for (int i = 0; i < k; i++) {
+        free(runs[i].buf);
+        close(runs[i].fd);
+    }
+    free(out);
+    free(lt.keys);
+    free(lt.tree);
+    free(runs);
+}
+
+double seconds_since(struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void report(const char *phase, off_t bytes, double secs)
+{
+    double mb = bytes / (1024.0 * 1024.0);
+    fprintf(stderr, "%s: %.1f MB in %.3f s (%.1f MB/s)\n", phase, mb, secs,
+            secs > 0 ? mb / secs : 0.0);
+}
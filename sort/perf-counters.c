@@ -0,0 +1,145 @@
+/* implementation of the perf-counters module */
+
+#include "perf-counters.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+const char *const COUNTER_NAMES[N_COUNTERS] = {
+    [COUNTER_CYCLES] = "cycles",
+    [COUNTER_INSTRUCTIONS] = "instructions",
+    [COUNTER_BRANCH_MISSES] = "branch_misses",
+    [COUNTER_L1D_MISSES] = "l1d_misses",
+    [COUNTER_LLC_MISSES] = "llc_misses",
+};
+
+#ifdef __linux__
+
+/* the perf_event_attr type and config of every counter */
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} EVENTS[N_COUNTERS] = {
+    [COUNTER_CYCLES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    [COUNTER_INSTRUCTIONS] = {
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,
+    },
+    [COUNTER_BRANCH_MISSES] = {
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,
+    },
+    [COUNTER_L1D_MISSES] = {
+        PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    },
+    [COUNTER_LLC_MISSES] = {
+        PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    },
+};
+
+static int open_event(int i)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = EVENTS[i].type;
+    attr.config = EVENTS[i].config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+        | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    /* this thread, on any CPU, in no group */
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int counters_open(struct counters *c)
+{
+    int n = 0;
+
+    for (int i = 0; i < N_COUNTERS; i++) {
+        c->fd[i] = open_event(i);
+        n += c->fd[i] >= 0;
+    }
+
+    return n;
+}
+
+void counters_start(struct counters *c)
+{
+    for (int i = 0; i < N_COUNTERS; i++) {
+        if (c->fd[i] >= 0) {
+            ioctl(c->fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(c->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void counters_stop(struct counters *c, double values[N_COUNTERS])
+{
+    for (int i = 0; i < N_COUNTERS; i++) {
+        if (c->fd[i] >= 0) {
+            ioctl(c->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    for (int i = 0; i < N_COUNTERS; i++) {
+        /* value, time enabled, time running */
+        uint64_t buf[3];
+
+        /* a counter that never got onto the PMU counts nothing useful */
+        if (c->fd[i] < 0 || read(c->fd[i], buf, sizeof(buf)) != sizeof(buf)
+                || buf[2] == 0) {
+            values[i] = -1;
+        } else {
+            values[i] = (double) buf[0] * buf[1] / buf[2];
+        }
+    }
+}
+
+#else
+
+int counters_open(struct counters *c)
+{
+    for (int i = 0; i < N_COUNTERS; i++) {
+        c->fd[i] = -1;
+    }
+
+    return 0;
+}
+
+void counters_start(struct counters *c)
+{
+    (void) c;
+}
+
+void counters_stop(struct counters *c, double values[N_COUNTERS])
+{
+    (void) c;
+    for (int i = 0; i < N_COUNTERS; i++) {
+        values[i] = -1;
+    }
+}
+
+#endif
+
+void counters_close(struct counters *c)
+{
+    for (int i = 0; i < N_COUNTERS; i++) {
+        if (c->fd[i] >= 0) {
+            close(c->fd[i]);
+            c->fd[i] = -1;
+        }
+    }
+}
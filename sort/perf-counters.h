@@ -0,0 +1,54 @@
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+/* Hardware performance counters read through Linux's perf_event_open. Only
+ * user-space events are counted, in the calling thread and in threads it
+ * creates while counting. Counters that the CPU, the kernel or its
+ * perf_event_paranoid setting do not provide are left out; on other systems,
+ * none are available. */
+
+enum counter {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_L1D_MISSES,
+    COUNTER_LLC_MISSES,
+    N_COUNTERS,
+};
+
+/* short names of the counters, e.g. for column headers */
+extern const char *const COUNTER_NAMES[N_COUNTERS];
+
+struct counters {
+    int fd[N_COUNTERS]; /* -1 if the counter is unavailable */
+};
+
+/* counters_open: open every counter that is available, all of them stopped
+ *
+ * c: the counters to be opened
+ * return: the number of available counters, 0 if none
+ */
+int counters_open(struct counters *c);
+
+/* counters_start: reset the available counters and start counting
+ *
+ * c: pointer to the counters
+ */
+void counters_start(struct counters *c);
+
+/* counters_stop: stop counting and get the counts since counters_start. If
+ * the kernel had to multiplex the counters, the counts are extrapolated from
+ * the time each one was actually running.
+ *
+ * c: pointer to the counters
+ * values: where the counts are written, -1 for unavailable counters
+ */
+void counters_stop(struct counters *c, double values[N_COUNTERS]);
+
+/* counters_close: close the counters
+ *
+ * c: the counters to be closed
+ */
+void counters_close(struct counters *c);
+
+#endif
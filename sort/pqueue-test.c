@@ -0,0 +1,144 @@
+#include "pqueue.h"
+#include <time.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* an event in a simulated scheduler, ordered by time */
+struct event {
+    long time;
+    int id;
+    int payload;
+};
+
+bool check_push_pop(int arity, int n);
+
+bool check_heapify_update(int arity, int n);
+
+/* push n events and pop them all, returning the elapsed nanoseconds */
+double time_push_pop(int arity, struct event *events, int n);
+
+static int event_cmp(const void *a, const void *b)
+{
+    const struct event *x = a, *y = b;
+    return (x->time > y->time) - (x->time < y->time);
+}
+
+int ARITIES[] = { 2, 4, 8 };
+
+int N_ARITIES = sizeof(ARITIES) / sizeof(ARITIES[0]);
+
+int main(void)
+{
+    srand(time(NULL)); // seed the random-number generator
+
+    bool ok = true;
+    for (int i = 0; i < N_ARITIES; i++) {
+        ok = check_push_pop(ARITIES[i], 10000) && ok;
+        ok = check_heapify_update(ARITIES[i], 10000) && ok;
+    }
+
+    int N = 0x1 << 20;
+    struct event *events = malloc(N * sizeof(*events));
+    for (int i = 0; i < N; i++) {
+        events[i] = (struct event) { .time = rand(), .id = i, .payload = 0 };
+    }
+
+    for (int i = 0; i < N_ARITIES; i++) {
+        double elapsed = time_push_pop(ARITIES[i], events, N);
+        printf("%d-ary: %d pushes and pops of %zu-byte elements take %.02f "
+               "milliseconds (%.02f M ops/s)\n", ARITIES[i], N,
+               sizeof(struct event), elapsed / 1e6, 2.0 * N / elapsed * 1e3);
+    }
+
+    free(events);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* pops have to come out in non-decreasing order, interleaved with pushes */
+bool check_push_pop(int arity, int n)
+{
+    struct pqueue *pq = pqueue_create(sizeof(struct event), arity, event_cmp);
+    long last = -1;
+    bool ok = true;
+
+    for (int i = 0; i < n; i++) {
+        struct event e = { .time = last + 1 + rand() % 1000, .id = i };
+        pqueue_push(pq, &e);
+
+        if (i % 3 == 2) {
+            struct event top;
+            pqueue_pop(pq, &top);
+            ok = ok && top.time >= last;
+            last = top.time;
+        }
+    }
+
+    struct event top;
+    while (pqueue_pop(pq, &top)) {
+        ok = ok && top.time >= last;
+        last = top.time;
+    }
+    ok = ok && pqueue_len(pq) == 0 && pqueue_peek(pq) == NULL;
+
+    if (!ok) {
+        printf("%d-ary push/pop BUG!\n", arity);
+    }
+
+    pqueue_free(pq);
+    return ok;
+}
+
+/* decrease every other key through its handle after a bulk heapify */
+bool check_heapify_update(int arity, int n)
+{
+    struct pqueue *pq = pqueue_create(sizeof(struct event), arity, event_cmp);
+    struct event *events = malloc(n * sizeof(*events));
+    int *handles = malloc(n * sizeof(*handles));
+    bool ok = true;
+
+    for (int i = 0; i < n; i++) {
+        events[i] = (struct event) { .time = rand() % n + n, .id = i };
+    }
+    pqueue_heapify(pq, events, n, handles);
+
+    for (int i = 0; i < n; i += 2) {
+        events[i].time -= n;
+        pqueue_update(pq, handles[i], &events[i]);
+    }
+
+    long last = -1;
+    struct event top;
+    while (pqueue_pop(pq, &top)) {
+        ok = ok && top.time >= last && top.time == events[top.id].time;
+        last = top.time;
+    }
+
+    if (!ok) {
+        printf("%d-ary heapify/update BUG!\n", arity);
+    }
+
+    free(handles);
+    free(events);
+    pqueue_free(pq);
+    return ok;
+}
+
+double time_push_pop(int arity, struct event *events, int n)
+{
+    struct pqueue *pq = pqueue_create(sizeof(struct event), arity, event_cmp);
+    struct timespec start, stop;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < n; i++) {
+        pqueue_push(pq, &events[i]);
+    }
+    struct event top;
+    while (pqueue_pop(pq, &top));
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    pqueue_free(pq);
+    return (stop.tv_sec - start.tv_sec) * 1e9
+        + (stop.tv_nsec - start.tv_nsec);
+}
@@ -0,0 +1,251 @@
+/* implementation of the pqueue module */
+
+#include "pqueue.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* internal representation of a priority queue */
+struct pqueue {
+    size_t size;  /* the size of an element */
+    int arity;    /* the number of children of a node */
+    int len;      /* the number of elements */
+    int cap;      /* the number of elements that fit in `data` */
+    int (*cmp)(const void *, const void *);
+    char *data;   /* cap + 1 elements; the extra one holds a sifted element */
+    int *handle;  /* handle[i]: the handle of the i-th element of the heap */
+    int *pos;     /* pos[h]: the index in the heap of the element with handle
+                   * h; the next free handle if h is not in use */
+    int free_handle; /* the first free handle, -1 if none */
+    int n_handles;   /* the number of handles ever given out */
+};
+
+static inline void *elem_at(struct pqueue *pq, int i)
+{
+    return pq->data + i * pq->size;
+}
+
+/* the extra slot after the last element */
+static inline void *tmp_slot(struct pqueue *pq)
+{
+    return elem_at(pq, pq->cap);
+}
+
+/* copy the element and its handle from index `from` to index `to` */
+static inline void move(struct pqueue *pq, int to, int from)
+{
+    memcpy(elem_at(pq, to), elem_at(pq, from), pq->size);
+    pq->handle[to] = pq->handle[from];
+    pq->pos[pq->handle[to]] = to;
+}
+
+/* place the element in the extra slot, whose handle is h, at index i */
+static inline void place(struct pqueue *pq, int i, int h)
+{
+    memcpy(elem_at(pq, i), tmp_slot(pq), pq->size);
+    pq->handle[i] = h;
+    pq->pos[h] = i;
+}
+
+/* moves the element at index i up while it is smaller than its parent. Like
+ * the rest of the sifting, this moves a hole instead of swapping. */
+static void bubble_up(struct pqueue *pq, int i)
+{
+    int h = pq->handle[i];
+    memcpy(tmp_slot(pq), elem_at(pq, i), pq->size);
+
+    while (i > 0) {
+        int parent = (i - 1) / pq->arity;
+
+        if (pq->cmp(tmp_slot(pq), elem_at(pq, parent)) < 0) {
+            move(pq, i, parent);
+            i = parent;
+        } else {
+            break;
+        }
+    }
+
+    place(pq, i, h);
+}
+
+/* moves the element at index i down while one of its children is smaller */
+static void bubble_down(struct pqueue *pq, int i)
+{
+    int h = pq->handle[i];
+    memcpy(tmp_slot(pq), elem_at(pq, i), pq->size);
+
+    for (;;) {
+        int first = pq->arity * i + 1;
+        if (first >= pq->len) {
+            break;
+        }
+
+        int last = pq->len - first < pq->arity ? pq->len : first + pq->arity;
+        int smallest = first;
+        for (int c = first + 1; c < last; c++) {
+            if (pq->cmp(elem_at(pq, c), elem_at(pq, smallest)) < 0) {
+                smallest = c;
+            }
+        }
+
+        if (pq->cmp(elem_at(pq, smallest), tmp_slot(pq)) < 0) {
+            move(pq, i, smallest);
+            i = smallest;
+        } else {
+            break;
+        }
+    }
+
+    place(pq, i, h);
+}
+
+/* make room for n more elements and handles */
+static void reserve(struct pqueue *pq, int n)
+{
+    if (pq->len + n > pq->cap) {
+        int cap = pq->cap;
+        while (pq->len + n > cap) {
+            cap *= 2;
+        }
+
+        pq->data = realloc(pq->data, (cap + 1) * pq->size);
+        pq->handle = realloc(pq->handle, cap * sizeof(int));
+        pq->pos = realloc(pq->pos, cap * sizeof(int));
+        pq->cap = cap;
+    }
+}
+
+/* hand out a handle for the element at index i; since there are never more
+ * handles in use than elements, pos[] always has room */
+static int new_handle(struct pqueue *pq, int i)
+{
+    int h = pq->free_handle;
+
+    if (h >= 0) {
+        pq->free_handle = pq->pos[h];
+    } else {
+        h = pq->n_handles++;
+    }
+
+    pq->handle[i] = h;
+    pq->pos[h] = i;
+    return h;
+}
+
+struct pqueue *pqueue_create(size_t size, int arity,
+                             int (*cmp)(const void *, const void *))
+{
+    assert(size > 0 && arity >= 2 && cmp != NULL);
+
+    struct pqueue *pq = malloc(sizeof(*pq));
+    pq->size = size;
+    pq->arity = arity;
+    pq->len = 0;
+    pq->cap = 16;
+    pq->cmp = cmp;
+    pq->data = malloc((pq->cap + 1) * size);
+    pq->handle = malloc(pq->cap * sizeof(int));
+    pq->pos = malloc(pq->cap * sizeof(int));
+    pq->free_handle = -1;
+    pq->n_handles = 0;
+
+    return pq;
+}
+
+void pqueue_free(struct pqueue *pq)
+{
+    free(pq->data);
+    free(pq->handle);
+    free(pq->pos);
+    free(pq);
+}
+
+int pqueue_len(struct pqueue *pq)
+{
+    return pq->len;
+}
+
+int pqueue_push(struct pqueue *pq, const void *elem)
+{
+    assert(pq != NULL && elem != NULL);
+
+    reserve(pq, 1);
+
+    int i = pq->len++;
+    memcpy(elem_at(pq, i), elem, pq->size);
+    int h = new_handle(pq, i);
+    bubble_up(pq, i);
+
+    return h;
+}
+
+void pqueue_heapify(struct pqueue *pq, const void *elems, int n, int *handles)
+{
+    assert(pq != NULL && n >= 0);
+
+    reserve(pq, n);
+
+    memcpy(elem_at(pq, pq->len), elems, n * pq->size);
+    for (int i = 0; i < n; i++) {
+        int h = new_handle(pq, pq->len + i);
+        if (handles != NULL) {
+            handles[i] = h;
+        }
+    }
+    pq->len += n;
+
+    /* Floyd's heap construction: sift down every parent, last one first */
+    for (int i = (pq->len - 2) / pq->arity; i >= 0 && pq->len > 1; i--) {
+        bubble_down(pq, i);
+    }
+}
+
+void *pqueue_peek(struct pqueue *pq)
+{
+    assert(pq != NULL);
+
+    return pq->len > 0 ? elem_at(pq, 0) : NULL;
+}
+
+bool pqueue_pop(struct pqueue *pq, void *out)
+{
+    assert(pq != NULL);
+
+    if (pq->len == 0) {
+        return false;
+    }
+
+    if (out != NULL) {
+        memcpy(out, elem_at(pq, 0), pq->size);
+    }
+
+    int h = pq->handle[0];
+    pq->pos[h] = pq->free_handle;
+    pq->free_handle = h;
+
+    if (--pq->len > 0) {
+        move(pq, 0, pq->len);
+        bubble_down(pq, 0);
+    }
+
+    return true;
+}
+
+void pqueue_update(struct pqueue *pq, int handle, const void *elem)
+{
+    assert(pq != NULL && handle >= 0 && handle < pq->n_handles);
+
+    /* the pos of a popped handle is the next free handle or -1, and the
+     * element there, if any, has another handle */
+    int i = pq->pos[handle];
+    assert(i >= 0 && i < pq->len && pq->handle[i] == handle);
+
+    memcpy(elem_at(pq, i), elem, pq->size);
+
+    if (i > 0 && pq->cmp(elem, elem_at(pq, (i - 1) / pq->arity)) < 0) {
+        bubble_up(pq, i);
+    } else {
+        bubble_down(pq, i);
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef PQUEUE_H_
+#define PQUEUE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* A d-ary min-heap priority queue. Elements are stored inline, `size` bytes
+ * each, so pushing and popping copy elements instead of allocating them.
+ * Every pushed element gets a handle that stays valid until the element is
+ * popped and can be used to change its priority. */
+struct pqueue;
+
+/* pqueue_create: create a new empty priority queue
+ *
+ * size: the size of an element in bytes
+ * arity: the number of children of a node, at least 2. 4 is a good default:
+ *        the heap is half as deep and siblings tend to share cache lines.
+ * cmp: comparison between two elements, as for qsort. The element that
+ *      compares the smallest is popped first.
+ * return: pointer to the newly created priority queue
+ */
+struct pqueue *pqueue_create(size_t size, int arity,
+                             int (*cmp)(const void *, const void *));
+
+/* pqueue_free: frees a priority queue
+ *
+ * pq: the priority queue to be freed
+ */
+void pqueue_free(struct pqueue *pq);
+
+/* pqueue_len: get the number of elements in the priority queue
+ *
+ * pq: pointer to the priority queue
+ */
+int pqueue_len(struct pqueue *pq);
+
+/* pqueue_push: adds a copy of an element
+ *
+ * pq: pointer to the priority queue
+ * elem: pointer to the element
+ * return: a handle to the element for pqueue_update
+ */
+int pqueue_push(struct pqueue *pq, const void *elem);
+
+/* pqueue_heapify: adds copies of n elements at once in O(n + len) time,
+ * which is cheaper than pushing them one at a time
+ *
+ * pq: pointer to the priority queue
+ * elems: array of n elements
+ * n: the number of elements
+ * handles: if not NULL, the handle of elems[i] is written to handles[i]
+ */
+void pqueue_heapify(struct pqueue *pq, const void *elems, int n, int *handles);
+
+/* pqueue_peek: get the smallest element without removing it
+ *
+ * pq: pointer to the priority queue
+ * return: pointer to the element inside the queue, valid until the next
+ *         modification. NULL if the queue is empty.
+ */
+void *pqueue_peek(struct pqueue *pq);
+
+/* pqueue_pop: removes the smallest element
+ *
+ * pq: pointer to the priority queue
+ * out: where the element is copied to, may be NULL
+ * return: false if the queue is empty, true otherwise
+ */
+bool pqueue_pop(struct pqueue *pq, void *out);
+
+/* pqueue_update: replaces an element in the queue, e.g. to decrease its key,
+ * and moves it to its new place in O(log n)
+ *
+ * pq: pointer to the priority queue
+ * handle: handle returned when the element was pushed. Passing the handle of
+ *         a popped element fails an assertion, unless a later push has been
+ *         given the same handle; it then updates that element.
+ * elem: pointer to the new value of the element
+ */
+void pqueue_update(struct pqueue *pq, int handle, const void *elem);
+
+#endif
@@ -0,0 +1,233 @@
+/* implementation of the sort-network module */
+
+#include "sort-network.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+/* compiled for AVX2 whatever the flags of the build, and only called once
+ * network_available has checked the CPU */
+#define AVX2 __attribute__((target("avx2")))
+
+bool network_available(void)
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+/* Compares every element of v with the element of `partner` in the same
+ * position, i.e. with its partner in v, and keeps the minimum or, where the
+ * bit of `mask` is set, the maximum. The mask must be a constant. */
+#define EXCHANGE(v, partner, mask)                             \
+    _mm256_blend_epi32(_mm256_min_epi32((v), (partner)),       \
+                       _mm256_max_epi32((v), (partner)), (mask))
+
+/* the partners i ^ 1, i ^ 2, 3 - i within every 4 elements, i ^ 4 and 7 - i */
+#define XOR_1(v) _mm256_shuffle_epi32((v), _MM_SHUFFLE(2, 3, 0, 1))
+#define XOR_2(v) _mm256_shuffle_epi32((v), _MM_SHUFFLE(1, 0, 3, 2))
+#define FLIP_4(v) _mm256_shuffle_epi32((v), _MM_SHUFFLE(0, 1, 2, 3))
+#define XOR_4(v) _mm256_permute2x128_si256((v), (v), 1)
+
+static inline AVX2 __m256i reverse(__m256i v)
+{
+    __m256i idx = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    return _mm256_permutevar8x32_epi32(v, idx);
+}
+
+/* sorts a bitonic register: one that ascends and then descends, or the
+ * other way around */
+static inline AVX2 __m256i clean(__m256i v)
+{
+    v = EXCHANGE(v, XOR_4(v), 0xf0);
+    v = EXCHANGE(v, XOR_2(v), 0xcc);
+    return EXCHANGE(v, XOR_1(v), 0xaa);
+}
+
+/* sorts one register. Every merge step compares an element with its mirror
+ * image in the other half, so that the halves need no reversal and every
+ * exchange puts the smaller value first. */
+static inline AVX2 __m256i sort8(__m256i v)
+{
+    v = EXCHANGE(v, XOR_1(v), 0xaa);
+
+    v = EXCHANGE(v, FLIP_4(v), 0xcc);
+    v = EXCHANGE(v, XOR_1(v), 0xaa);
+
+    v = EXCHANGE(v, reverse(v), 0xf0);
+    v = EXCHANGE(v, XOR_2(v), 0xcc);
+    return EXCHANGE(v, XOR_1(v), 0xaa);
+}
+
+/* merges the sorted registers *a and *b: afterwards *a holds the 8 smallest
+ * of their 16 elements and *b the 8 largest, both sorted */
+static inline AVX2 void merge2(__m256i *a, __m256i *b)
+{
+    __m256i r = reverse(*b);
+    __m256i lo = _mm256_min_epi32(*a, r);
+    __m256i hi = _mm256_max_epi32(*a, r);
+
+    *a = clean(lo);
+    *b = clean(hi);
+}
+
+/* sorts the 16 elements of v[0] and v[1] */
+static inline AVX2 void sort16(__m256i *v)
+{
+    v[0] = sort8(v[0]);
+    v[1] = sort8(v[1]);
+    merge2(&v[0], &v[1]);
+}
+
+/* sorts the 32 elements of v[0..4) */
+static inline AVX2 void sort32(__m256i *v)
+{
+    sort16(v);
+    sort16(v + 2);
+
+    /* flip: v[0] and v[1] against v[3] and v[2] reversed */
+    __m256i r3 = reverse(v[3]), r2 = reverse(v[2]);
+    __m256i lo0 = _mm256_min_epi32(v[0], r3);
+    __m256i hi0 = _mm256_max_epi32(v[0], r3);
+    __m256i lo1 = _mm256_min_epi32(v[1], r2);
+    __m256i hi1 = _mm256_max_epi32(v[1], r2);
+
+    /* both halves are bitonic now; half-clean them across registers */
+    v[0] = clean(_mm256_min_epi32(lo0, lo1));
+    v[1] = clean(_mm256_max_epi32(lo0, lo1));
+    v[2] = clean(_mm256_min_epi32(hi0, hi1));
+    v[3] = clean(_mm256_max_epi32(hi0, hi1));
+}
+
+/* the mask of the first n of 8 lanes, for n in [0, 8] */
+static inline AVX2 __m256i lanes(int n)
+{
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32(n),
+                              _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+void AVX2 network_sort(int *arr, size_t len)
+{
+    __m256i v[NETWORK_MAX / 8];
+    int n_regs = len <= 8 ? 1 : len <= 16 ? 2 : 4;
+
+    /* the lanes past the end are never read or written, even if they would
+     * cross into an unmapped page */
+    for (int r = 0; r < n_regs; r++) {
+        int n = (int) len - 8 * r;
+        v[r] = _mm256_set1_epi32(INT_MAX);
+        if (n > 0) {
+            __m256i mask = lanes(n < 8 ? n : 8);
+            __m256i x = _mm256_maskload_epi32(arr + 8 * r, mask);
+            v[r] = _mm256_blendv_epi8(v[r], x, mask);
+        }
+    }
+
+    if (n_regs == 1) {
+        v[0] = sort8(v[0]);
+    } else if (n_regs == 2) {
+        sort16(v);
+    } else {
+        sort32(v);
+    }
+
+    for (int r = 0; r < n_regs; r++) {
+        int n = (int) len - 8 * r;
+        if (n > 0) {
+            _mm256_maskstore_epi32(arr + 8 * r, lanes(n < 8 ? n : 8), v[r]);
+        }
+    }
+}
+
+/* merges a[0..m) and b[0..n) into out one element at a time */
+static void merge_scalar(const int *a, size_t m, const int *b, size_t n,
+                         int *out)
+{
+    size_t i = 0, j = 0;
+
+    while (i < m && j < n) {
+        *out++ = a[i] <= b[j] ? a[i++] : b[j++];
+    }
+    while (i < m) {
+        *out++ = a[i++];
+    }
+    while (j < n) {
+        *out++ = b[j++];
+    }
+}
+
+/* Keeps the 8 largest elements merged so far in a register and merges them
+ * with the next 8 of the array whose next element is smaller: the 8 smallest
+ * of those 16 are then no larger than anything not yet merged. The 8 stored
+ * always lag the i + j elements loaded by 8, and i <= m, so with out + m == b
+ * a store never reaches b + j. */
+void AVX2 network_merge(const int *a, size_t m, const int *b, size_t n,
+                        int *out)
+{
+    __m256i lo = _mm256_loadu_si256((const __m256i *) a);
+    __m256i hi = _mm256_loadu_si256((const __m256i *) b);
+    size_t i = 8, j = 8;
+    bool from_a;
+
+    for (;;) {
+        merge2(&lo, &hi);
+        _mm256_storeu_si256((__m256i *) out, lo);
+        out += 8;
+
+        from_a = i < m && (j == n || a[i] <= b[j]);
+        if (from_a ? m - i < 8 : n - j < 8) {
+            break;
+        }
+
+        if (from_a) {
+            lo = _mm256_loadu_si256((const __m256i *) (a + i));
+            i += 8;
+        } else {
+            lo = _mm256_loadu_si256((const __m256i *) (b + j));
+            j += 8;
+        }
+    }
+
+    /* The array that was due next has fewer than 8 elements left. Merge them
+     * with the register first, then that with the rest of the other array. */
+    int rest[8], short_rest[16];
+    _mm256_storeu_si256((__m256i *) rest, hi);
+
+    const int *s = from_a ? a + i : b + j;
+    size_t s_len = from_a ? m - i : n - j;
+
+    merge_scalar(rest, 8, s, s_len, short_rest);
+    if (from_a) {
+        merge_scalar(short_rest, 8 + s_len, b + j, n - j, out);
+    } else {
+        merge_scalar(short_rest, 8 + s_len, a + i, m - i, out);
+    }
+}
+
+#else
+
+bool network_available(void)
+{
+    return false;
+}
+
+void network_sort(int *arr, size_t len)
+{
+    (void) arr;
+    (void) len;
+    abort();
+}
+
+void network_merge(const int *a, size_t m, const int *b, size_t n, int *out)
+{
+    (void) a;
+    (void) m;
+    (void) b;
+    (void) n;
+    (void) out;
+    abort();
+}
+
+#endif
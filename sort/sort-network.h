@@ -0,0 +1,41 @@
+#ifndef SORT_NETWORK_H_
+#define SORT_NETWORK_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Bitonic sorting networks on ints in AVX2 registers of 8 ints each. They
+ * compare and exchange whole registers at a time without branching, which
+ * makes them faster than insertion sort on short arrays and than a scalar
+ * merge on long ones. The ints are moved as values, so equal keys can be
+ * reordered; for plain ints that is indistinguishable from a stable sort. */
+
+/* the longest array that network_sort sorts */
+#define NETWORK_MAX 32
+
+/* network_available: whether the CPU runs the networks, i.e. has AVX2. The
+ * other functions may only be called if it does.
+ *
+ * return: true if the networks may be used
+ */
+bool network_available(void);
+
+/* network_sort: sort a short array with a network of 8, 16 or 32 ints, padded
+ * with INT_MAX
+ *
+ * arr: the array to be sorted
+ * len: its length, at most NETWORK_MAX
+ */
+void network_sort(int *arr, size_t len);
+
+/* network_merge: merge the sorted arrays a[0..m) and b[0..n) into `out`, 8
+ * ints at a time with a bitonic merge of two registers
+ *
+ * a, b: the sorted arrays, of at least 8 ints each
+ * out: m + n ints, which must not overlap `a`. It may overlap `b` only as
+ *      out + m == b, i.e. with `b` at the end of `out`: no int of `b` is
+ *      overwritten before it has been read, which tim_sort relies on.
+ */
+void network_merge(const int *a, size_t m, const int *b, size_t n, int *out);
+
+#endif
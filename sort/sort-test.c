@@ -1,51 +1,371 @@
 #include "sort.h"
+#include "sort-template.h"
+#include "perf-counters.h"
+#include <math.h>
 #include <time.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
+#include <stdnoreturn.h>
+#include <unistd.h>
+
+struct config {
+    int min_log2;       /* the smallest size is 2 ^ min_log2 */
+    int max_log2;       /* the largest size is 2 ^ max_log2 */
+    int quadratic_log2; /* skip O(n^2) sorts above 2 ^ quadratic_log2 */
+    int reps;           /* number of timed runs per cell */
+    bool json;          /* print JSON instead of CSV */
+    bool parallel;      /* sweep thread counts of parallel_merge_sort */
+    bool counters;      /* report hardware counters per element */
+    int top_k;          /* if not 0, also time the k-smallest functions for
+                         * this k */
+    size_t huge;        /* if not 0, only time the size_t sorts on this many
+                         * elements */
+    const char *alg;    /* only run algorithms whose name contains this */
+    const char *input;  /* only run inputs whose name contains this */
+};
+
+/* timings of one (algorithm, input, size) cell, in nanoseconds */
+struct result {
+    const char *alg;
+    const char *input;
+    size_t len;
+    int reps;
+    double min;
+    double median;
+    double p99;
+    double counts[N_COUNTERS]; /* median counts per run, -1 if unavailable */
+};
+
+noreturn void usage(const char *name);
+
+void parse_args(int argc, char *argv[], struct config *c);
+
+/* open the counters for --counters, turning the option off if none of them
+ * are available, e.g. in a VM or under a strict perf_event_paranoid */
+void open_counters(struct config *c);
+
+void close_counters(struct config *c);
 
 int *make_random_arr(int len);
 
-bool is_sorted(int *arr, int len);
+int *make_sorted_arr(int len);
+
+int *make_reverse_arr(int len);
+
+int *make_few_unique_arr(int len);
+
+int *make_small_range_arr(int len);
+
+int *make_organ_pipe_arr(int len);
+
+int *make_zipfian_arr(int len);
+
+int *make_nearly_sorted_arr(int len);
+
+bool is_sorted(int *arr, size_t len);
+
+/* Run `sort` c->reps times on copies of ref_arr and summarize the timings in
+ * *res. Returns false if any run did not sort the array. */
+bool time_sort(struct config *c, int *ref_arr, int len,
+               void (*sort)(int *arr, int len), struct result *res);
+
+/* summarize the run times and counter values of c->reps runs in *res */
+void summarize(struct config *c, double *times, double (*counts)[N_COUNTERS],
+               struct result *res);
+
+void print_header(struct config *c);
+
+void print_result(struct config *c, struct result *res);
+
+void print_footer(struct config *c);
+
+bool time_parallel(struct config *c, int len);
+
+/* Checks select_nth, partial_sort and top_k against a sorted copy on small
+ * inputs, for k = 0, 1, len - 1, len and beyond. Returns false and reports
+ * every failure on stderr if any of them is wrong. */
+bool check_selection(void);
 
-void time_sort(int *arr, int len, const char *name,
-               void (*sort)(int *arr, int len));
+/* Checks generic_sort on doubles and floats, which take the paths for 8- and
+ * 4-byte elements, and on structs of 7 and 12 bytes, which are moved byte by
+ * byte. Returns false and reports failures on stderr if any is wrong. */
+bool check_generic_sort(void);
+
+/* Checks string_sort against qsort with strcmp on strings with long shared
+ * prefixes, duplicates, empty strings and bytes above 127, and on a skewed
+ * input of nested prefixes. Returns false and reports failures on stderr if
+ * any is wrong. */
+bool check_string_sort(void);
+
+/* Runs `select` c->reps times on copies of ref_arr and checks that it wrote
+ * the c->top_k smallest values, in order, to its output */
+bool time_select(struct config *c, int *ref_arr, int len,
+                 int (*select)(int *arr, int len, int k, int *out),
+                 struct result *res);
+
+bool time_huge(struct config *c);
+
+void generic_int_sort(int *arr, int len);
+
+void template_int_sort(int *arr, int len);
 
 struct sort_alg {
     const char *name;
     void (*sort)(int *arr, int len);
+    bool quadratic;
 };
 
 struct sort_alg ALGS[] = {
-    {"Insertion Sort", insertion_sort},
-    {"Selection Sort", selection_sort},
-    {"Bubble Sort", bubble_sort},
-    {"Merge Sort", merge_sort},
-    {"Quick Sort", quick_sort},
-    {"Heap Sort", heap_sort},
+    {"Insertion Sort", insertion_sort, true},
+    {"Selection Sort", selection_sort, true},
+    {"Bubble Sort", bubble_sort, true},
+    {"Merge Sort", merge_sort, false},
+    {"Bottom-Up Merge Sort", merge_sort_bottom_up, false},
+    {"In-Place Merge Sort", merge_sort_in_place, false},
+    {"Tim Sort", tim_sort, false},
+    {"Quick Sort", quick_sort, false},
+    {"Block Quick Sort", block_quick_sort, false},
+    {"3-Way Quick Sort", quick_sort_3way, false},
+    {"Heap Sort", heap_sort, false},
+    {"Bottom-Up Heap Sort", heap_sort_bottom_up, false},
+    {"4-ary Heap Sort", heap_sort_dary, false},
+    {"Radix Sort", radix_sort, false},
+    {"Counting Sort", counting_sort, false},
+    {"Generic Sort", generic_int_sort, false},
+    {"Template Sort", template_int_sort, false},
+    {"Auto Sort", sort_auto, false},
 };
 
 int N_ALGS = sizeof(ALGS) / sizeof(ALGS[0]);
 
-int main(void)
+struct input {
+    const char *name;
+    int *(*make)(int len);
+};
+
+/* sorted, reverse and organ-pipe inputs are the classic worst cases of a
+ * quick sort that pivots on the first element */
+struct input INPUTS[] = {
+    {"random", make_random_arr},
+    {"sorted", make_sorted_arr},
+    {"reverse", make_reverse_arr},
+    {"few-unique", make_few_unique_arr},
+    {"small-range", make_small_range_arr},
+    {"organ-pipe", make_organ_pipe_arr},
+    {"zipfian", make_zipfian_arr},
+    {"nearly-sorted", make_nearly_sorted_arr},
+};
+
+int N_INPUTS = sizeof(INPUTS) / sizeof(INPUTS[0]);
+
+/* Ways to find the k smallest values of arr, in order, in out. They return
+ * how many they wrote, min(k, len). */
+int sort_select(int *arr, int len, int k, int *out);
+
+int partial_sort_select(int *arr, int len, int k, int *out);
+
+int top_k_select(int *arr, int len, int k, int *out);
+
+struct select_alg {
+    const char *name;
+    int (*select)(int *arr, int len, int k, int *out);
+};
+
+/* the heap of top_k takes O(n log k) time and O(k) memory in one pass */
+struct select_alg SELECT_ALGS[] = {
+    {"Quick Sort + Copy", sort_select},
+    {"Partial Sort", partial_sort_select},
+    {"Streaming Top-K", top_k_select},
+};
+
+int N_SELECT_ALGS = sizeof(SELECT_ALGS) / sizeof(SELECT_ALGS[0]);
+
+void parallel_sort_sz(int *arr, size_t len);
+
+void parallel_counting_sort_nprocs_sz(int *arr, size_t len);
+
+/* the sorts run by --huge, which may exceed INT_MAX elements */
+struct huge_alg {
+    const char *name;
+    void (*sort)(int *arr, size_t len);
+};
+
+struct huge_alg HUGE_ALGS[] = {
+    {"Merge Sort", merge_sort_sz},
+    {"Parallel Merge Sort", parallel_sort_sz},
+    {"Tim Sort", tim_sort_sz},
+    {"Quick Sort", quick_sort_sz},
+    {"3-Way Quick Sort", quick_sort_3way_sz},
+    {"Heap Sort", heap_sort_sz},
+    {"Radix Sort", radix_sort_sz},
+    {"Counting Sort", counting_sort_sz},
+    {"Parallel Counting Sort", parallel_counting_sort_nprocs_sz},
+};
+
+int N_HUGE_ALGS = sizeof(HUGE_ALGS) / sizeof(HUGE_ALGS[0]);
+
+int main(int argc, char *argv[])
 {
+    struct config c = {
+        .min_log2 = 4,
+        .max_log2 = 20,
+        .quadratic_log2 = 12,
+        .reps = 5,
+        .json = false,
+        .parallel = false,
+        .counters = false,
+        .top_k = 0,
+        .huge = 0,
+        .alg = "",
+        .input = "",
+    };
+    parse_args(argc, argv, &c);
+    open_counters(&c);
+
     srand(time(NULL)); // seed the random-number generator
 
-    int N = 0x1 << 16; // 2 ^ 20 = 1,048,576 elements
-    int *ref_arr = make_random_arr(N);
+    bool ok = check_selection();
+    ok = check_generic_sort() && ok;
+    ok = check_string_sort() && ok;
+    print_header(&c);
+
+    if (c.huge > 0) {
+        ok = time_huge(&c) && ok;
+        print_footer(&c);
+        close_counters(&c);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    for (int log2 = c.min_log2; log2 <= c.max_log2; log2++) {
+        int len = 0x1 << log2;
+
+        for (int j = 0; j < N_INPUTS; j++) {
+            if (strstr(INPUTS[j].name, c.input) == NULL) {
+                continue;
+            }
 
-    for (int i = 0; i < N_ALGS; i++) {
-        int *arr = malloc(N * sizeof(*arr));
-        memcpy(arr, ref_arr, N * sizeof(*arr));
+            int *ref_arr = INPUTS[j].make(len);
 
-        time_sort(arr, N, ALGS[i].name, ALGS[i].sort);
+            for (int i = 0; i < N_ALGS; i++) {
+                if (strstr(ALGS[i].name, c.alg) == NULL
+                        || (ALGS[i].quadratic && log2 > c.quadratic_log2)) {
+                    continue;
+                }
 
-        free(arr);
+                struct result res = {
+                    .alg = ALGS[i].name,
+                    .input = INPUTS[j].name,
+                };
+                if (!time_sort(&c, ref_arr, len, ALGS[i].sort, &res)) {
+                    fprintf(stderr, "%s BUG on %s input of %d elements!\n",
+                            ALGS[i].name, INPUTS[j].name, len);
+                    ok = false;
+                }
+                print_result(&c, &res);
+            }
+
+            for (int i = 0; c.top_k > 0 && i < N_SELECT_ALGS; i++) {
+                if (strstr(SELECT_ALGS[i].name, c.alg) == NULL) {
+                    continue;
+                }
+
+                char name[64];
+                snprintf(name, sizeof(name), "%s (k = %d)",
+                         SELECT_ALGS[i].name, c.top_k);
+
+                struct result res = { .alg = name, .input = INPUTS[j].name };
+                if (!time_select(&c, ref_arr, len, SELECT_ALGS[i].select,
+                                 &res)) {
+                    fprintf(stderr, "%s BUG on %s input of %d elements!\n",
+                            name, INPUTS[j].name, len);
+                    ok = false;
+                }
+                print_result(&c, &res);
+            }
+
+            free(ref_arr);
+        }
     }
 
-    free(ref_arr);
-    return EXIT_SUCCESS;
+    if (c.parallel) {
+        ok = time_parallel(&c, 0x1 << c.max_log2) && ok;
+    }
+
+    print_footer(&c);
+    close_counters(&c);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+noreturn void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [options]\nOptions:\n", name);
+    fprintf(stderr, "\t--min LOG2\tSmallest size is 2^LOG2 (default 4).\n");
+    fprintf(stderr, "\t--max LOG2\tLargest size is 2^LOG2 (default 20, at "
+                    "most 26).\n");
+    fprintf(stderr, "\t--quadratic-max LOG2\tSkip O(n^2) sorts above 2^LOG2 "
+                    "elements (default 12).\n");
+    fprintf(stderr, "\t--reps N\tTimed runs per measurement (default 5).\n");
+    fprintf(stderr, "\t--alg NAME\tOnly run algorithms whose name contains "
+                    "NAME.\n");
+    fprintf(stderr, "\t--input NAME\tOnly run inputs whose name contains "
+                    "NAME.\n");
+    fprintf(stderr, "\t--json\t\tPrint JSON instead of CSV.\n");
+    fprintf(stderr, "\t--parallel\tSweep parallel_merge_sort over 1..nproc "
+                    "threads at the largest size.\n");
+    fprintf(stderr, "\t--counters\tAlso report cycles, instructions, branch "
+                    "misses and L1d and LLC misses per element, where the "
+                    "hardware and kernel provide them.\n");
+    fprintf(stderr, "\t--top-k K\tAlso time finding the K smallest "
+                    "elements by sorting, partial_sort and the streaming "
+                    "top_k.\n");
+    fprintf(stderr, "\t--huge N\tOnly time the size_t sorts on N random "
+                    "elements, e.g. 2200000000 for more than 2^31. Needs "
+                    "8 * N bytes of memory.\n");
+    fprintf(stderr, "\t-h\t\tPrint this message.\n");
+    exit(EXIT_FAILURE);
+}
+
+void parse_args(int argc, char *argv[], struct config *c)
+{
+    for (int i = 1; i < argc; i++) {
+        /* whether an option taking a value has one */
+        bool has_value = i + 1 < argc;
+
+        if (strcmp(argv[i], "--min") == 0 && has_value) {
+            c->min_log2 = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max") == 0 && has_value) {
+            c->max_log2 = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--quadratic-max") == 0 && has_value) {
+            c->quadratic_log2 = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--reps") == 0 && has_value) {
+            c->reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--alg") == 0 && has_value) {
+            c->alg = argv[++i];
+        } else if (strcmp(argv[i], "--input") == 0 && has_value) {
+            c->input = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0) {
+            c->json = true;
+        } else if (strcmp(argv[i], "--parallel") == 0) {
+            c->parallel = true;
+        } else if (strcmp(argv[i], "--counters") == 0) {
+            c->counters = true;
+        } else if (strcmp(argv[i], "--top-k") == 0 && has_value) {
+            c->top_k = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--huge") == 0 && has_value) {
+            c->huge = strtoull(argv[++i], NULL, 10);
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    /* 10 * 2^26 is the largest key range make_random_arr fits in an int */
+    if (c->min_log2 < 0 || c->max_log2 > 26 || c->min_log2 > c->max_log2
+            || c->reps < 1 || c->top_k < 0) {
+        usage(argv[0]);
+    }
 }
 
 int *make_random_arr(int len)
@@ -59,13 +379,102 @@ int *make_random_arr(int len)
     return arr;
 }
 
-bool is_sorted(int *arr, int len)
+int *make_sorted_arr(int len)
+{
+    int *arr = malloc(len * sizeof(*arr));
+
+    for (int i = 0; i < len; i++) {
+        arr[i] = i;
+    }
+
+    return arr;
+}
+
+int *make_reverse_arr(int len)
+{
+    int *arr = malloc(len * sizeof(*arr));
+
+    for (int i = 0; i < len; i++) {
+        arr[i] = len - i;
+    }
+
+    return arr;
+}
+
+/* only 16 distinct keys, like grades or enums */
+int *make_few_unique_arr(int len)
+{
+    int *arr = malloc(len * sizeof(*arr));
+
+    for (int i = 0; i < len; i++) {
+        arr[i] = rand() % 16;
+    }
+
+    return arr;
+}
+
+/* keys in [0, 65536), like scores or the codes of an enum; counting sort
+ * applies from 2^17 elements on */
+int *make_small_range_arr(int len)
+{
+    int *arr = malloc(len * sizeof(*arr));
+
+    for (int i = 0; i < len; i++) {
+        arr[i] = rand() % 65536;
+    }
+
+    return arr;
+}
+
+/* ascending for the first half, descending for the second: 0 1 2 .. 2 1 0 */
+int *make_organ_pipe_arr(int len)
+{
+    int *arr = malloc(len * sizeof(*arr));
+
+    for (int i = 0; i < len; i++) {
+        arr[i] = i < len / 2 ? i : len - 1 - i;
+    }
+
+    return arr;
+}
+
+/* keys in [1, len] where key k appears with probability roughly proportional
+ * to 1 / k, drawn by inverting the continuous approximation of the CDF */
+int *make_zipfian_arr(int len)
+{
+    int *arr = malloc(len * sizeof(*arr));
+    double log_range = log(len + 1.0);
+
+    for (int i = 0; i < len; i++) {
+        double u = (double) rand() / ((double) RAND_MAX + 1.0);
+        arr[i] = (int) exp(u * log_range);
+    }
+
+    return arr;
+}
+
+/* sorted, except that 1% of the elements are swapped with random others */
+int *make_nearly_sorted_arr(int len)
+{
+    int *arr = make_sorted_arr(len);
+
+    for (int n = len / 100 + 1; len > 1 && n > 0; n--) {
+        int i = rand() % len, j = rand() % len;
+        int tmp = arr[i];
+        arr[i] = arr[j];
+        arr[j] = tmp;
+    }
+
+    return arr;
+}
+
+bool is_sorted(int *arr, size_t len)
 {
     if (len <= 1) {
         return true;
     }
 
-    for (int i = 1; i < len; i++) {
+    for (size_t i = 1; i < len; i++) {
         if (arr[i - 1] > arr[i]) {
             return false;
         }
@@ -74,22 +483,644 @@ bool is_sorted(int *arr, int len)
     return true;
 }
 
-void time_sort(int *arr, int len, const char *name,
-        void (*sort)(int *arr, int len))
+static double elapsed_ns(struct timespec *start, struct timespec *stop)
+{
+    return (stop->tv_sec - start->tv_sec) * 1e9
+        + (stop->tv_nsec - start->tv_nsec);
+}
+
+static int double_cmp(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/* the hardware counters, opened by open_counters if c->counters is set */
+static struct counters counters;
+
+void open_counters(struct config *c)
+{
+    if (!c->counters) {
+        return;
+    }
+
+    int n = counters_open(&counters);
+    if (n == 0) {
+        fprintf(stderr, "hardware counters are unavailable, reporting "
+                        "wall-clock time only\n");
+        c->counters = false;
+        return;
+    }
+
+    for (int k = 0; k < N_COUNTERS; k++) {
+        if (counters.fd[k] < 0) {
+            fprintf(stderr, "counter %s is unavailable\n", COUNTER_NAMES[k]);
+        }
+    }
+}
+
+void close_counters(struct config *c)
 {
-    struct timespec start, stop;
+    if (c->counters) {
+        counters_close(&counters);
+    }
+}
 
-    clock_gettime(CLOCK_REALTIME, &start);
-    sort(arr, len);
-    clock_gettime(CLOCK_REALTIME, &stop);
+static void start_counters(struct config *c)
+{
+    if (c->counters) {
+        counters_start(&counters);
+    }
+}
 
-    double elapsed = (stop.tv_sec - start.tv_sec) * 1000.0
-        + (stop.tv_nsec - start.tv_nsec) / 1000000.0;
-    if (is_sorted(arr, len)) {
-        printf("%s takes %.02f milliseconds to sort %d elements (verified)\n",
-                name, elapsed, len);
+static void stop_counters(struct config *c, double values[N_COUNTERS])
+{
+    if (c->counters) {
+        counters_stop(&counters, values);
     } else {
-        printf("%s BUG!\n", name);
+        for (int k = 0; k < N_COUNTERS; k++) {
+            values[k] = -1;
+        }
+    }
+}
+
+bool time_sort(struct config *c, int *ref_arr, int len,
+        void (*sort)(int *arr, int len), struct result *res)
+{
+    int *arr = malloc(len * sizeof(*arr));
+    double *times = malloc(c->reps * sizeof(*times));
+    double (*counts)[N_COUNTERS] = malloc(c->reps * sizeof(*counts));
+    bool sorted = true;
+
+    for (int r = 0; r < c->reps; r++) {
+        struct timespec start, stop;
+        memcpy(arr, ref_arr, len * sizeof(*arr));
+
+        start_counters(c);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        sort(arr, len);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        stop_counters(c, counts[r]);
+
+        times[r] = elapsed_ns(&start, &stop);
+        sorted = sorted && is_sorted(arr, len);
     }
+
+    res->len = len;
+    summarize(c, times, counts, res);
+
+    free(counts);
+    free(times);
+    free(arr);
+    return sorted;
 }
 
+bool time_select(struct config *c, int *ref_arr, int len,
+                 int (*select)(int *arr, int len, int k, int *out),
+                 struct result *res)
+{
+    int k = c->top_k < len ? c->top_k : len;
+    int *arr = malloc(len * sizeof(*arr));
+    int *out = malloc(k * sizeof(*out));
+    double *times = malloc(c->reps * sizeof(*times));
+    double (*counts)[N_COUNTERS] = malloc(c->reps * sizeof(*counts));
+    bool ok = true;
+
+    /* the expected output */
+    int *smallest = malloc(len * sizeof(*smallest));
+    memcpy(smallest, ref_arr, len * sizeof(*smallest));
+    quick_sort(smallest, len);
+
+    for (int r = 0; r < c->reps; r++) {
+        struct timespec start, stop;
+        memcpy(arr, ref_arr, len * sizeof(*arr));
+
+        start_counters(c);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int n = select(arr, len, c->top_k, out);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        stop_counters(c, counts[r]);
+
+        times[r] = elapsed_ns(&start, &stop);
+        ok = ok && n == k && memcmp(out, smallest, k * sizeof(*out)) == 0;
+    }
+
+    res->len = len;
+    summarize(c, times, counts, res);
+
+    free(smallest);
+    free(counts);
+    free(times);
+    free(out);
+    free(arr);
+    return ok;
+}
+
+void summarize(struct config *c, double *times, double (*counts)[N_COUNTERS],
+               struct result *res)
+{
+    generic_sort(times, c->reps, sizeof(*times), double_cmp);
+
+    /* p99 is the nearest-rank percentile, i.e. the slowest run below 100
+     * repetitions */
+    res->reps = c->reps;
+    res->min = times[0];
+    res->median = times[(c->reps - 1) / 2];
+    res->p99 = times[(int) ceil(0.99 * c->reps) - 1];
+
+    /* the runs are sorted by time, so reuse `times` for one counter at a
+     * time */
+    for (int k = 0; k < N_COUNTERS; k++) {
+        for (int r = 0; r < c->reps; r++) {
+            times[r] = counts[r][k];
+        }
+        generic_sort(times, c->reps, sizeof(*times), double_cmp);
+        res->counts[k] = times[(c->reps - 1) / 2];
+    }
+}
+
+/* the number of results printed so far, to separate JSON objects */
+static int n_results = 0;
+
+void print_header(struct config *c)
+{
+    if (c->json) {
+        printf("[\n");
+    } else {
+        printf("algorithm,input,size,reps,min_ns,median_ns,p99_ns,"
+               "ns_per_elem");
+        for (int k = 0; c->counters && k < N_COUNTERS; k++) {
+            printf(",%s_per_elem", COUNTER_NAMES[k]);
+        }
+        printf("\n");
+    }
+}
+
+void print_result(struct config *c, struct result *res)
+{
+    double per_elem = res->median / res->len;
+
+    if (c->json) {
+        printf("%s  {\"algorithm\": \"%s\", \"input\": \"%s\", \"size\": %zu, "
+               "\"reps\": %d, \"min_ns\": %.0f, \"median_ns\": %.0f, "
+               "\"p99_ns\": %.0f, \"ns_per_elem\": %.3f",
+               n_results > 0 ? ",\n" : "", res->alg, res->input, res->len,
+               res->reps, res->min, res->median, res->p99, per_elem);
+    } else {
+        printf("%s,%s,%zu,%d,%.0f,%.0f,%.0f,%.3f", res->alg, res->input,
+               res->len, res->reps, res->min, res->median, res->p99, per_elem);
+    }
+
+    /* unavailable counters are null in JSON and empty in CSV */
+    for (int k = 0; c->counters && k < N_COUNTERS; k++) {
+        double count = res->counts[k];
+        if (c->json && count < 0) {
+            printf(", \"%s_per_elem\": null", COUNTER_NAMES[k]);
+        } else if (c->json) {
+            printf(", \"%s_per_elem\": %.3f", COUNTER_NAMES[k],
+                   count / res->len);
+        } else if (count < 0) {
+            printf(",");
+        } else {
+            printf(",%.3f", count / res->len);
+        }
+    }
+
+    printf(c->json ? "}" : "\n");
+    fflush(stdout);
+
+    n_results++;
+}
+
+void print_footer(struct config *c)
+{
+    if (c->json) {
+        printf("\n]\n");
+    }
+}
+
+/* the thread count used by parallel_sort */
+static int n_threads = 1;
+
+static void parallel_sort(int *arr, int len)
+{
+    parallel_merge_sort(arr, len, n_threads);
+}
+
+/* reports parallel_merge_sort on random input with every thread count from 1
+ * to the number of online processors; the speedups over merge_sort are
+ * printed to stderr */
+bool time_parallel(struct config *c, int len)
+{
+    int *ref_arr = make_random_arr(len);
+    bool ok = true;
+
+    struct result serial = { .alg = "Merge Sort", .input = "random" };
+    ok = time_sort(c, ref_arr, len, merge_sort, &serial);
+    print_result(c, &serial);
+
+    int nprocs = sysconf(_SC_NPROCESSORS_ONLN);
+    for (n_threads = 1; n_threads <= nprocs; n_threads++) {
+        char name[64];
+        snprintf(name, sizeof(name), "Parallel Merge Sort (%d threads)",
+                 n_threads);
+
+        struct result res = { .alg = name, .input = "random" };
+        ok = time_sort(c, ref_arr, len, parallel_sort, &res) && ok;
+        print_result(c, &res);
+
+        fprintf(stderr, "%2d threads: speedup %.02fx\n", n_threads,
+                serial.median / res.median);
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Parallel Merge Sort BUG!\n");
+    }
+
+    free(ref_arr);
+    return ok;
+}
+
+void parallel_sort_sz(int *arr, size_t len)
+{
+    parallel_merge_sort_sz(arr, len, sysconf(_SC_NPROCESSORS_ONLN));
+}
+
+void parallel_counting_sort_nprocs_sz(int *arr, size_t len)
+{
+    parallel_counting_sort_sz(arr, len, sysconf(_SC_NPROCESSORS_ONLN));
+}
+
+/* fills arr with random ints from xorshift64*; rand() is too slow and too
+ * narrow for billions of elements */
+static void fill_random(int *arr, size_t len, uint64_t seed)
+{
+    uint64_t x = seed;
+
+    for (size_t i = 0; i < len; i++) {
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        arr[i] = (int) ((x * 0x2545F4914F6CDD1Dull) >> 32);
+    }
+}
+
+/* Times the size_t sorts on c->huge random elements. To leave as much memory
+ * as possible to the sorts' scratch buffers, the input is regenerated before
+ * every run instead of being copied from a reference array. */
+bool time_huge(struct config *c)
+{
+    size_t len = c->huge;
+    int *arr = malloc(len * sizeof(*arr));
+    double *times = malloc(c->reps * sizeof(*times));
+    double (*counts)[N_COUNTERS] = malloc(c->reps * sizeof(*counts));
+    bool ok = true;
+
+    if (arr == NULL) {
+        fprintf(stderr, "cannot allocate %zu elements\n", len);
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < N_HUGE_ALGS; i++) {
+        if (strstr(HUGE_ALGS[i].name, c->alg) == NULL) {
+            continue;
+        }
+
+        bool sorted = true;
+        for (int r = 0; r < c->reps; r++) {
+            struct timespec start, stop;
+            fill_random(arr, len, 88172645463325252ull + r);
+
+            start_counters(c);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            HUGE_ALGS[i].sort(arr, len);
+            clock_gettime(CLOCK_MONOTONIC, &stop);
+            stop_counters(c, counts[r]);
+
+            times[r] = elapsed_ns(&start, &stop);
+            sorted = sorted && is_sorted(arr, len);
+        }
+
+        struct result res = {
+            .alg = HUGE_ALGS[i].name,
+            .input = "random",
+            .len = len,
+        };
+        summarize(c, times, counts, &res);
+        print_result(c, &res);
+
+        if (!sorted) {
+            fprintf(stderr, "%s BUG on %zu elements!\n", HUGE_ALGS[i].name,
+                    len);
+            ok = false;
+        }
+    }
+
+    free(counts);
+    free(times);
+    free(arr);
+    return ok;
+}
+
+static int int_cmp(const void *a, const void *b)
+{
+    int x = *(const int *) a, y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+void generic_int_sort(int *arr, int len)
+{
+    generic_sort(arr, len, sizeof(*arr), int_cmp);
+}
+
+#define INT_LESS(a, b) ((a) < (b))
+SORT_DEFINE(int_sort, int, INT_LESS)
+
+void template_int_sort(int *arr, int len)
+{
+    int_sort(arr, len);
+}
+
+int sort_select(int *arr, int len, int k, int *out)
+{
+    k = k < len ? k : len;
+    quick_sort(arr, len);
+    memcpy(out, arr, k * sizeof(*out));
+    return k;
+}
+
+int partial_sort_select(int *arr, int len, int k, int *out)
+{
+    k = k < len ? k : len;
+    partial_sort(arr, len, k);
+    memcpy(out, arr, k * sizeof(*out));
+    return k;
+}
+
+int top_k_select(int *arr, int len, int k, int *out)
+{
+    return top_k(arr, len, k, out);
+}
+
+/* reports a failed check of check_selection */
+static bool check(bool ok, const char *what, const char *input, int len,
+                  int k)
+{
+    if (!ok) {
+        fprintf(stderr, "%s BUG on %s input of %d elements with k = %d!\n",
+                what, input, len, k);
+    }
+    return ok;
+}
+
+bool check_selection(void)
+{
+    static const int LENS[] = {0, 1, 2, 3, 17, 100, 1000};
+    const int n_lens = sizeof(LENS) / sizeof(LENS[0]);
+    bool ok = true;
+
+    for (int j = 0; j < N_INPUTS; j++) {
+        for (int l = 0; l < n_lens; l++) {
+            int len = LENS[l];
+            int *ref_arr = INPUTS[j].make(len);
+            int *sorted = malloc((len + 1) * sizeof(*sorted));
+            int *arr = malloc((len + 1) * sizeof(*arr));
+            int *out = malloc((len + 1) * sizeof(*out));
+
+            memcpy(sorted, ref_arr, len * sizeof(*sorted));
+            quick_sort(sorted, len);
+
+            /* the edges, a k in the middle and a k beyond the end */
+            int ks[] = {0, 1, len / 2, len - 1, len, len + 5};
+            for (int i = 0; i < (int) (sizeof(ks) / sizeof(ks[0])); i++) {
+                int k = ks[i];
+                if (k < 0) {
+                    continue;
+                }
+                int n = k < len ? k : len;
+
+                if (k < len) {
+                    memcpy(arr, ref_arr, len * sizeof(*arr));
+                    int x = select_nth(arr, len, k);
+                    bool split = x == sorted[k];
+                    for (int m = 0; m < len; m++) {
+                        split = split && (m < k ? arr[m] <= x : arr[m] >= x);
+                    }
+                    ok = check(split, "select_nth", INPUTS[j].name, len, k)
+                        && ok;
+                }
+
+                memcpy(arr, ref_arr, len * sizeof(*arr));
+                partial_sort(arr, len, k);
+                bool prefix = memcmp(arr, sorted, n * sizeof(*arr)) == 0;
+                quick_sort(arr, len);
+                prefix = prefix && memcmp(arr, sorted, len * sizeof(*arr)) == 0;
+                ok = check(prefix, "partial_sort", INPUTS[j].name, len, k)
+                    && ok;
+
+                bool top = top_k(ref_arr, len, k, out) == n
+                    && memcmp(out, sorted, n * sizeof(*out)) == 0;
+                ok = check(top, "top_k", INPUTS[j].name, len, k) && ok;
+            }
+
+            free(out);
+            free(arr);
+            free(sorted);
+            free(ref_arr);
+        }
+    }
+
+    return ok;
+}
+
+static int float_cmp(const void *a, const void *b)
+{
+    float x = *(const float *) a, y = *(const float *) b;
+    return (x > y) - (x < y);
+}
+
+/* 7 bytes with no padding: a key and the index the record started at */
+struct odd_record {
+    unsigned char key;
+    unsigned char index[6];
+};
+
+/* 12 bytes, aligned like an int */
+struct int_record {
+    int key;
+    int index;
+    int check; /* -index, to catch records that are not moved whole */
+};
+
+static int odd_record_cmp(const void *a, const void *b)
+{
+    const struct odd_record *x = a, *y = b;
+    return (x->key > y->key) - (x->key < y->key);
+}
+
+static int int_record_cmp(const void *a, const void *b)
+{
+    const struct int_record *x = a, *y = b;
+    return (x->key > y->key) - (x->key < y->key);
+}
+
+bool check_generic_sort(void)
+{
+    const int len = 1000;
+    bool ok = true;
+
+    double *doubles = malloc(len * sizeof(*doubles));
+    double *double_ref = malloc(len * sizeof(*double_ref));
+    float *floats = malloc(len * sizeof(*floats));
+    float *float_ref = malloc(len * sizeof(*float_ref));
+    for (int i = 0; i < len; i++) {
+        doubles[i] = double_ref[i] = (rand() - RAND_MAX / 2) / 7.0;
+        floats[i] = float_ref[i] = (rand() % 100 - 50) / 4.0f;
+    }
+
+    generic_sort(doubles, len, sizeof(*doubles), double_cmp);
+    qsort(double_ref, len, sizeof(*double_ref), double_cmp);
+    if (memcmp(doubles, double_ref, len * sizeof(*doubles)) != 0) {
+        fprintf(stderr, "generic_sort BUG on doubles!\n");
+        ok = false;
+    }
+
+    generic_sort(floats, len, sizeof(*floats), float_cmp);
+    qsort(float_ref, len, sizeof(*float_ref), float_cmp);
+    if (memcmp(floats, float_ref, len * sizeof(*floats)) != 0) {
+        fprintf(stderr, "generic_sort BUG on floats!\n");
+        ok = false;
+    }
+
+    /* the keys repeat, so the records are checked for being in order and for
+     * being a permutation of the original ones */
+    struct odd_record *odd = malloc(len * sizeof(*odd));
+    struct int_record *ints = malloc(len * sizeof(*ints));
+    unsigned char *odd_keys = malloc(len);
+    int *int_keys = malloc(len * sizeof(*int_keys));
+    for (int i = 0; i < len; i++) {
+        odd[i].key = odd_keys[i] = rand() % 50;
+        memset(odd[i].index, 0, sizeof(odd[i].index));
+        memcpy(odd[i].index, &i, sizeof(i));
+        ints[i].key = int_keys[i] = rand() % 50 - 25;
+        ints[i].index = i;
+        ints[i].check = -i;
+    }
+
+    generic_sort(odd, len, sizeof(*odd), odd_record_cmp);
+    generic_sort(ints, len, sizeof(*ints), int_record_cmp);
+
+    bool *seen_odd = calloc(len, sizeof(bool));
+    bool *seen_int = calloc(len, sizeof(bool));
+    bool odd_ok = true, int_ok = true;
+    for (int i = 0; i < len; i++) {
+        int index;
+        memcpy(&index, odd[i].index, sizeof(index));
+        odd_ok = odd_ok && index >= 0 && index < len && !seen_odd[index]
+            && odd_keys[index] == odd[i].key
+            && (i == 0 || odd[i - 1].key <= odd[i].key);
+        if (odd_ok) {
+            seen_odd[index] = true;
+        }
+
+        index = ints[i].index;
+        int_ok = int_ok && index >= 0 && index < len && !seen_int[index]
+            && int_keys[index] == ints[i].key && ints[i].check == -index
+            && (i == 0 || ints[i - 1].key <= ints[i].key);
+        if (int_ok) {
+            seen_int[index] = true;
+        }
+    }
+    if (!odd_ok) {
+        fprintf(stderr, "generic_sort BUG on 7-byte records!\n");
+        ok = false;
+    }
+    if (!int_ok) {
+        fprintf(stderr, "generic_sort BUG on 12-byte records!\n");
+        ok = false;
+    }
+
+    free(seen_int);
+    free(seen_odd);
+    free(int_keys);
+    free(odd_keys);
+    free(ints);
+    free(odd);
+    free(float_ref);
+    free(floats);
+    free(double_ref);
+    free(doubles);
+    return ok;
+}
+
+static int strcmp_cmp(const void *a, const void *b)
+{
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+/* sorts strs with string_sort and compares the result with qsort's */
+static bool check_strings(char **strs, int len, const char *input)
+{
+    char **ref = malloc(len * sizeof(*ref));
+    memcpy(ref, strs, len * sizeof(*ref));
+    qsort(ref, len, sizeof(*ref), strcmp_cmp);
+
+    string_sort(strs, len);
+
+    /* equal strings may be different copies, so compare the contents */
+    bool ok = true;
+    for (int i = 0; i < len; i++) {
+        ok = ok && strcmp(strs[i], ref[i]) == 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "string_sort BUG on %s strings!\n", input);
+    }
+
+    free(ref);
+    return ok;
+}
+
+bool check_string_sort(void)
+{
+    const int len = 2000;
+    char **strs = malloc(len * sizeof(*strs));
+    bool ok = true;
+
+    /* a few prefixes, then up to 3 characters from a small alphabet that
+     * includes bytes above 127, which strcmp orders after ASCII */
+    static const char *const PREFIXES[] = {"", "a", "ab", "abab", "b"};
+    static const char ALPHABET[] = "ab\xe9";
+    for (int i = 0; i < len; i++) {
+        char str[16];
+        int n = snprintf(str, sizeof(str), "%s", PREFIXES[rand() % 5]);
+        for (int j = rand() % 4; j > 0; j--) {
+            str[n++] = ALPHABET[rand() % 3];
+        }
+        str[n] = '\0';
+        strs[i] = strdup(str);
+    }
+    ok = check_strings(strs, len, "prefix-heavy") && ok;
+    for (int i = 0; i < len; i++) {
+        free(strs[i]);
+    }
+
+    /* "", "x", "xx", ... shuffled: every partition puts one string aside */
+    for (int i = 0; i < len; i++) {
+        strs[i] = malloc(i + 1);
+        memset(strs[i], 'x', i);
+        strs[i][i] = '\0';
+    }
+    for (int i = len - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        char *tmp = strs[i];
+        strs[i] = strs[j];
+        strs[j] = tmp;
+    }
+    ok = check_strings(strs, len, "nested") && ok;
+    for (int i = 0; i < len; i++) {
+        free(strs[i]);
+    }
+
+    free(strs);
+    return ok;
+}
@@ -1,36 +1,59 @@
 #include "sort.h"
+#include "sort-network.h"
+#include "sort-template.h"
+#include "thread-pool.h"
 
+#include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static inline void swap(int *arr, int i, int j)
+/* Lengths and indices are size_t throughout, so arrays of more than INT_MAX
+ * elements can be sorted. Loops that count down are written so that they
+ * never step below zero. */
+
+/* ranges no longer than this are finished off with insertion sort */
+#define INSERTION_THRESHOLD 16
+
+/* sorts a range of up to NETWORK_MAX elements, with a sorting network if the
+ * CPU runs them */
+static void small_sort(int *arr, size_t len)
+{
+    if (network_available()) {
+        network_sort(arr, len);
+    } else {
+        insertion_sort_sz(arr, len);
+    }
+}
+
+static inline void swap(int *arr, size_t i, size_t j)
 {
     int tmp = arr[i];
     arr[i] = arr[j];
     arr[j] = tmp;
 }
 
-void insertion_sort(int *arr, int len)
+void insertion_sort_sz(int *arr, size_t len)
 {
-    for (int i = 0; i < len; i++) {
+    for (size_t i = 1; i < len; i++) {
         int key = arr[i];
 
-        int j;
-        for (j = i - 1; j >= 0 && arr[j] > key; j--) {
-            arr[j + 1] = arr[j];
+        size_t j;
+        for (j = i; j > 0 && arr[j - 1] > key; j--) {
+            arr[j] = arr[j - 1];
         }
 
-        arr[j + 1] = key;
+        arr[j] = key;
     }
 }
 
-void selection_sort(int *arr, int len)
+void selection_sort_sz(int *arr, size_t len)
 {
-    for (int i = 0; i < len - 1; i++) {
-        int min_idx = i;
-        for (int j = i + 1; j < len; j++) {
+    for (size_t i = 0; i + 1 < len; i++) {
+        size_t min_idx = i;
+        for (size_t j = i + 1; j < len; j++) {
             if (arr[j] < arr[min_idx]) {
                 min_idx = j;
             }
@@ -39,13 +62,13 @@ void selection_sort(int *arr, int len)
     }
 }
 
-void bubble_sort(int *arr, int len)
+void bubble_sort_sz(int *arr, size_t len)
 {
     bool swapped;
 
-    for (int i = 0; i < len - 1; i++) {
+    for (size_t i = 0; i + 1 < len; i++) {
         swapped = false;
-        for (int j = 0; j < len - i - 1; j++) {
+        for (size_t j = 0; j + 1 < len - i; j++) {
             if (arr[j] > arr[j + 1]) {
                 swap(arr, j, j + 1);
                 swapped = true;
@@ -58,54 +81,74 @@ void bubble_sort(int *arr, int len)
     }
 }
 
-static void merge(int *arr, int *scratch, int start, int mid, int end)
+/* merges the sorted arrays a[0..m) and b[0..n) into out, taking from `a` first
+ * on ties so that the merge is stable. The vectorized merge may take equal
+ * ints from either side, which makes no difference for ints. As for
+ * network_merge, out may overlap `b` only as out + m == b. */
+static void merge_into(const int *a, size_t m, const int *b, size_t n,
+                       int *out)
 {
-    int len1 = mid - start;
-    int len2 = end - mid;
-
-    if (arr[mid - 1] <= arr[mid]) {
+    if (m >= 8 && n >= 8 && network_available()) {
+        network_merge(a, m, b, n, out);
         return;
     }
 
-    int *arr1 = scratch + start;
-    int *arr2 = scratch + mid;
-
-    memcpy(arr1, &arr[start], len1 * sizeof(int));
-    memcpy(arr2, &arr[mid], len2 * sizeof(int));
-
-    int front1 = 0, front2 = 0, curr_idx = start;
+    size_t front1 = 0, front2 = 0, curr_idx = 0;
 
-    while (front1 < len1 && front2 < len2) {
-        if (arr1[front1] <= arr2[front2]) {
-            arr[curr_idx++] = arr1[front1++];
+    while (front1 < m && front2 < n) {
+        if (a[front1] <= b[front2]) {
+            out[curr_idx++] = a[front1++];
         } else {
-            arr[curr_idx++] = arr2[front2++];
+            out[curr_idx++] = b[front2++];
         }
     }
 
-    while (front1 < len1) {
-        arr[curr_idx++] = arr1[front1++];
+    while (front1 < m) {
+        out[curr_idx++] = a[front1++];
+    }
+
+    while (front2 < n) {
+        out[curr_idx++] = b[front2++];
     }
+}
 
-    while (front2 < len2) {
-        arr[curr_idx++] = arr2[front2++];
+static void merge(int *arr, int *scratch, size_t start, size_t mid,
+                  size_t end)
+{
+    size_t len1 = mid - start;
+    size_t len2 = end - mid;
+
+    if (arr[mid - 1] <= arr[mid]) {
+        return;
     }
+
+    int *arr1 = scratch + start;
+    int *arr2 = scratch + mid;
+
+    memcpy(arr1, &arr[start], len1 * sizeof(int));
+    memcpy(arr2, &arr[mid], len2 * sizeof(int));
+
+    merge_into(arr1, len1, arr2, len2, &arr[start]);
 }
 
-static void merge_sort_impl(int *arr, int *scratch, int start, int end)
+static void merge_sort_impl(int *arr, int *scratch, size_t start, size_t end)
 {
+    if (end - start <= NETWORK_MAX && network_available()) {
+        network_sort(arr + start, end - start);
+        return;
+    }
     if (end - start <= 1) {
         return;
     }
 
-    int mid = start + (end - start) / 2;
+    size_t mid = start + (end - start) / 2;
 
     merge_sort_impl(arr, scratch, start, mid);
     merge_sort_impl(arr, scratch, mid, end);
     merge(arr, scratch, start, mid, end);
 }
 
-void merge_sort(int *arr, int len)
+void merge_sort_sz(int *arr, size_t len)
 {
     /* Reduce the number of allocations by pre-allocating a ``scratch''
      * area for all sub-calls */
@@ -116,85 +159,2139 @@ void merge_sort(int *arr, int len)
     free(scratch);
 }
 
-static int partition(int *arr, int start, int end)
+/* merge_sort_bottom_up starts from runs of this length sorted by small_sort */
+#define BOTTOM_UP_RUN NETWORK_MAX
+
+/* Iterative merge sort. Each pass merges pairs of runs from one buffer into
+ * the other, so the halves are never copied into scratch before a merge as
+ * merge() does; at most one copy back is needed at the very end. */
+void merge_sort_bottom_up_sz(int *arr, size_t len)
 {
-    int pivot = arr[start];
-    int next = end - 1;
+    for (size_t start = 0; start < len; start += BOTTOM_UP_RUN) {
+        size_t n = len - start < BOTTOM_UP_RUN ? len - start : BOTTOM_UP_RUN;
+        small_sort(arr + start, n);
+    }
 
-    for (int i = end - 1; i > start; i--) {
-        if (arr[i] > pivot) {
-            swap(arr, next--, i);
+    if (len <= BOTTOM_UP_RUN) {
+        return;
+    }
+
+    int *scratch = malloc(len * sizeof(int));
+    int *src = arr, *dst = scratch;
+
+    for (size_t width = BOTTOM_UP_RUN; width < len; width *= 2) {
+        for (size_t start = 0; start < len; start += 2 * width) {
+            size_t mid = len - start < width ? len : start + width;
+            size_t end = len - mid < width ? len : mid + width;
+
+            merge_into(&src[start], mid - start, &src[mid], end - mid,
+                       &dst[start]);
         }
+
+        int *tmp = src;
+        src = dst;
+        dst = tmp;
     }
 
-    swap(arr, start, next);
-    return next;
+    if (src != arr) {
+        memcpy(arr, src, len * sizeof(int));
+    }
+
+    free(scratch);
+}
+
+/* reverses arr[start..end) */
+static void reverse(int *arr, size_t start, size_t end)
+{
+    while (end - start > 1) {
+        swap(arr, start++, --end);
+    }
+}
+
+/* the first index in arr[start..end) whose value is > key */
+static size_t upper_bound(int *arr, size_t start, size_t end, int key)
+{
+    while (start < end) {
+        size_t mid = start + (end - start) / 2;
+        if (key < arr[mid]) {
+            end = mid;
+        } else {
+            start = mid + 1;
+        }
+    }
+
+    return start;
+}
+
+/* swaps arr[i..i + n) with arr[j..j + n), which do not overlap */
+static void swap_blocks(int *arr, size_t i, size_t j, size_t n)
+{
+    for (size_t k = 0; k < n; k++) {
+        swap(arr, i + k, j + k);
+    }
+}
+
+/* Stable merge of arr[start..mid) and arr[mid..end) through buf, which holds
+ * the shorter run. A shorter left run is merged front to back by merge_into,
+ * whose output then ends where the right run begins; a shorter right run is
+ * merged back to front. */
+static void merge_buffered(int *arr, size_t start, size_t mid, size_t end,
+                           int *buf)
+{
+    size_t len1 = mid - start;
+    size_t len2 = end - mid;
+
+    if (len1 <= len2) {
+        memcpy(buf, &arr[start], len1 * sizeof(int));
+        merge_into(buf, len1, &arr[mid], len2, &arr[start]);
+    } else {
+        memcpy(buf, &arr[mid], len2 * sizeof(int));
+
+        size_t i = mid, j = len2, k = end;
+        while (i > start && j > 0) {
+            arr[--k] = buf[j - 1] < arr[i - 1] ? arr[--i] : buf[--j];
+        }
+        memcpy(&arr[start], buf, j * sizeof(int));
+    }
+}
+
+/* Block merge of arr[start..mid) and arr[mid..end), both longer than the
+ * block size bs, through bs ints of buf and (end - start) / bs entries of
+ * `order`. The left run starts with a partial block and the right run ends
+ * with one; the full blocks in between are put in the order of their first
+ * values by block swaps, and one pass then merges every block with what is
+ * left of the blocks of the other run before it. Every element moves O(1)
+ * times, so merges take linear time and the sort O(n log n). */
+static void merge_blocks(int *arr, size_t start, size_t mid, size_t end,
+                         int *buf, size_t bs, size_t *order)
+{
+    size_t first = start + (mid - start) % bs;
+    size_t na = (mid - first) / bs;
+    size_t nb = (end - mid) / bs;
+    size_t last = mid + nb * bs;
+
+    /* order[t] is the block that goes to place t, numbered from `first` on;
+     * ties go to the left run */
+    size_t a = 0, b = na;
+    for (size_t t = 0; t < na + nb; t++) {
+        if (b == na + nb || (a < na && arr[first + a * bs]
+                                       <= arr[first + b * bs])) {
+            order[t] = a++;
+        } else {
+            order[t] = b++;
+        }
+    }
+
+    /* The places before t hold their blocks already, so the block that goes
+     * to t has been swapped on to wherever following `order` from its first
+     * place leads */
+    for (size_t t = 0; t < na + nb; t++) {
+        size_t src = order[t];
+        while (src < t) {
+            src = order[src];
+        }
+        if (src != t) {
+            swap_blocks(arr, first + t * bs, first + src * bs, bs);
+        }
+    }
+
+    /* arr[p..q) is pending: it comes from one run, and nothing after it is
+     * smaller. A block from the same run leaves it in place. A block from the
+     * other run is merged with it, after which only the values above the
+     * smaller of the two last values are pending, all from the run whose last
+     * value was larger. */
+    size_t p = start;
+    bool pending_left = true;
+    for (size_t t = 0; t < na + nb; t++) {
+        size_t q = first + t * bs;
+        bool left = order[t] < na;
+
+        if (left == pending_left || p == q) {
+            p = q;
+            pending_left = left;
+            continue;
+        }
+
+        int p_last = arr[q - 1], q_last = arr[q + bs - 1];
+        merge_buffered(arr, p, q, q + bs, buf);
+        p = upper_bound(arr, p, q + bs, p_last < q_last ? p_last : q_last);
+        if (p_last <= q_last) {
+            pending_left = left;
+        }
+    }
+
+    if (last < end && arr[last - 1] > arr[last]) {
+        merge_buffered(arr, start, last, end, buf);
+    }
+}
+
+/* Stable merge of arr[start..mid) and arr[mid..end) with buf_len ints of buf
+ * and buf_len entries of `order`, where buf_len * buf_len >= end - start */
+static void merge_in_place(int *arr, size_t start, size_t mid, size_t end,
+                           int *buf, size_t buf_len, size_t *order)
+{
+    if (start == mid || mid == end || arr[mid - 1] <= arr[mid]) {
+        return;
+    }
+
+    if (mid - start <= buf_len || end - mid <= buf_len) {
+        merge_buffered(arr, start, mid, end, buf);
+    } else {
+        merge_blocks(arr, start, mid, end, buf, buf_len, order);
+    }
 }
 
-static void quick_sort_impl(int *arr, int start, int end)
+static void merge_sort_in_place_impl(int *arr, size_t start, size_t end,
+                                     int *buf, size_t buf_len, size_t *order)
 {
+    if (end - start <= NETWORK_MAX && network_available()) {
+        network_sort(arr + start, end - start);
+        return;
+    }
     if (end - start <= 1) {
         return;
     }
 
-    int p = partition(arr, start, end);
+    size_t mid = start + (end - start) / 2;
 
-    quick_sort_impl(arr, start, p);
-    quick_sort_impl(arr, p + 1, end);
+    merge_sort_in_place_impl(arr, start, mid, buf, buf_len, order);
+    merge_sort_in_place_impl(arr, mid, end, buf, buf_len, order);
+    merge_in_place(arr, start, mid, end, buf, buf_len, order);
 }
 
-void quick_sort(int *arr, int len)
+void merge_sort_in_place_sz(int *arr, size_t len)
 {
-    quick_sort_impl(arr, 0, len);
+    /* sqrt(len) ints of buffer, also the block size of block merges, and as
+     * many block numbers */
+    size_t buf_len = 64;
+    while (buf_len * buf_len < len) {
+        buf_len *= 2;
+    }
+
+    int *buf = malloc(buf_len * sizeof(int));
+    size_t *order = malloc(buf_len * sizeof(size_t));
+
+    merge_sort_in_place_impl(arr, 0, len, buf, buf_len, order);
+
+    free(buf);
+    free(order);
 }
 
-static void bubble_up(int *arr, int i)
+/* ranges shorter than this are sorted or merged serially by a single task */
+#define PARALLEL_CUTOFF (1 << 14)
+
+/* co_rank: finds how many of the first k elements of the stable merge of
+ * a[0..m) and b[0..n) come from `a`. The rest, k - i, come from `b`. */
+static size_t co_rank(size_t k, const int *a, size_t m, const int *b,
+                      size_t n)
 {
-    while (i > 0) {
-        int parent = (i - 1) / 2;
+    size_t lo = k > n ? k - n : 0;
+    size_t hi = k < m ? k : m;
 
-        if (arr[parent] < arr[i]) {
-            swap(arr, parent, i);
-            i = parent;
+    /* a[i] <= b[k - i - 1] means a[i] is still among the first k outputs */
+    while (lo < hi) {
+        size_t i = lo + (hi - lo) / 2;
+        if (a[i] <= b[k - i - 1]) {
+            lo = i + 1;
         } else {
-            break;
+            hi = i;
         }
     }
+
+    return lo;
 }
 
-static void bubble_down(int *arr, int len, int i)
+struct pmerge_args {
+    struct tpool *pool;
+    const int *a;
+    size_t m;
+    const int *b;
+    size_t n;
+    int *out;
+};
+
+/* merges in parallel by splitting the output in half at its co-rank and
+ * merging both halves as separate tasks */
+static void pmerge_task(void *arg)
 {
-    for (;;) {
-        int largest = i;
-        int left = 2 * i + 1;
-        int right = 2 * i + 2;
+    struct pmerge_args *args = arg;
 
-        if (left < len && arr[left] > arr[largest]) {
-            largest = left;
+    size_t total = args->m + args->n;
+    if (total <= PARALLEL_CUTOFF) {
+        merge_into(args->a, args->m, args->b, args->n, args->out);
+        return;
+    }
+
+    size_t k = total / 2;
+    size_t i = co_rank(k, args->a, args->m, args->b, args->n);
+
+    struct pmerge_args left = {
+        args->pool, args->a, i, args->b, k - i, args->out,
+    };
+    struct pmerge_args right = {
+        args->pool, args->a + i, args->m - i, args->b + (k - i),
+        args->n - (k - i), args->out + k,
+    };
+
+    struct tpool_join join = { 0 };
+    tpool_spawn(args->pool, &join, pmerge_task, &left);
+    pmerge_task(&right);
+    tpool_wait(args->pool, &join);
+}
+
+struct psort_args {
+    struct tpool *pool;
+    int *arr;
+    int *scratch;
+    size_t start;
+    size_t end;
+};
+
+static void psort_task(void *arg)
+{
+    struct psort_args *args = arg;
+    int *arr = args->arr;
+    size_t start = args->start, end = args->end;
+
+    if (end - start <= PARALLEL_CUTOFF) {
+        merge_sort_impl(arr, args->scratch, start, end);
+        return;
+    }
+
+    size_t mid = start + (end - start) / 2;
+
+    struct psort_args left = { args->pool, arr, args->scratch, start, mid };
+    struct psort_args right = { args->pool, arr, args->scratch, mid, end };
+
+    struct tpool_join join = { 0 };
+    tpool_spawn(args->pool, &join, psort_task, &left);
+    psort_task(&right);
+    tpool_wait(args->pool, &join);
+
+    if (arr[mid - 1] <= arr[mid]) {
+        return;
+    }
+
+    /* both halves are adjacent in `scratch`, so a single copy suffices */
+    memcpy(args->scratch + start, &arr[start], (end - start) * sizeof(int));
+
+    struct pmerge_args merge_args = {
+        args->pool, args->scratch + start, mid - start, args->scratch + mid,
+        end - mid, &arr[start],
+    };
+    pmerge_task(&merge_args);
+}
+
+void parallel_merge_sort_sz(int *arr, size_t len, int nthreads)
+{
+    if (nthreads <= 1 || len <= PARALLEL_CUTOFF) {
+        merge_sort_sz(arr, len);
+        return;
+    }
+
+    int *scratch = malloc(len * sizeof(int));
+    struct tpool *pool = tpool_create(nthreads);
+
+    struct psort_args args = { pool, arr, scratch, 0, len };
+    tpool_run(pool, psort_task, &args);
+
+    tpool_free(pool);
+    free(scratch);
+}
+
+/* tim_sort switches a merge into galloping mode after this many consecutive
+ * elements come from the same run. Galloping has to be earned first: a merge
+ * runs the counting merge only when min_gallop is at most this, and the plain
+ * vectorized merge_into otherwise. */
+#define MIN_GALLOP 7
+
+/* tim_sort's run stack stays logarithmic in length because of the
+ * invariants kept by merge_collapse */
+#define MAX_RUNS 85
+
+struct tim_state {
+    int *arr;
+    int *tmp;       /* scratch for a run being merged */
+    int min_gallop; /* adapts to how well galloping has been paying off */
+    int n_runs;
+    size_t run_base[MAX_RUNS];
+    size_t run_len[MAX_RUNS];
+};
+
+/* the minimum run length: a number in (NETWORK_MAX / 2, NETWORK_MAX] such
+ * that len / min_run is a power of two or slightly less, or slightly more in
+ * the one case where that would take NETWORK_MAX + 1. Short runs are extended
+ * to it by small_sort in one go. */
+static size_t min_run_length(size_t len)
+{
+    size_t r = 0;
+
+    while (len > NETWORK_MAX) {
+        r |= len & 1;
+        len >>= 1;
+    }
+
+    return len + r > NETWORK_MAX ? NETWORK_MAX : len + r;
+}
+
+/* returns the length of the run starting at arr[start]. A strictly descending
+ * run is reversed in place; strictness keeps the sort stable */
+static size_t count_run(int *arr, size_t start, size_t end)
+{
+    size_t i = start + 1;
+
+    if (i == end) {
+        return 1;
+    }
+
+    if (arr[i] < arr[start]) {
+        while (i + 1 < end && arr[i + 1] < arr[i]) {
+            i++;
+        }
+        for (size_t lo = start, hi = i; lo < hi; lo++, hi--) {
+            swap(arr, lo, hi);
         }
+    } else {
+        while (i + 1 < end && arr[i + 1] >= arr[i]) {
+            i++;
+        }
+    }
 
-        if (right < len && arr[right] > arr[largest]) {
-            largest = right;
+    return i + 1 - start;
+}
+
+/* gallop_left: returns k such that a[k - 1] < key <= a[k], searching
+ * exponentially outwards from a[hint] and then by binary search. The bounds
+ * are signed because the search to the left starts from a[-1]. */
+static size_t gallop_left(int key, const int *a, size_t n, size_t hint)
+{
+    ptrdiff_t last = 0, ofs = 1;
+
+    if (a[hint] < key) {
+        ptrdiff_t max_ofs = n - hint;
+        while (ofs < max_ofs && a[hint + ofs] < key) {
+            last = ofs;
+            ofs = (ofs << 1) + 1;
         }
+        if (ofs > max_ofs) {
+            ofs = max_ofs;
+        }
+        last += hint;
+        ofs += hint;
+    } else {
+        ptrdiff_t max_ofs = hint + 1;
+        while (ofs < max_ofs && !(a[hint - ofs] < key)) {
+            last = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > max_ofs) {
+            ofs = max_ofs;
+        }
+        ptrdiff_t tmp = last;
+        last = hint - ofs;
+        ofs = hint - tmp;
+    }
 
-        if (largest != i) {
-            swap(arr, i, largest);
-            i = largest;
+    /* a[last] < key <= a[ofs], where a[-1] and a[n] are imaginary */
+    last++;
+    while (last < ofs) {
+        ptrdiff_t mid = last + (ofs - last) / 2;
+        if (a[mid] < key) {
+            last = mid + 1;
         } else {
-            break;
+            ofs = mid;
         }
     }
+
+    return ofs;
 }
 
-void heap_sort(int *arr, int len)
+/* gallop_right: like gallop_left, but returns k such that
+ * a[k - 1] <= key < a[k] */
+static size_t gallop_right(int key, const int *a, size_t n, size_t hint)
 {
-    (void) bubble_up;
-    for (int i = len / 2 - 1; i >= 0; i--) {
-        bubble_down(arr, len, i);
+    ptrdiff_t last = 0, ofs = 1;
+
+    if (key < a[hint]) {
+        ptrdiff_t max_ofs = hint + 1;
+        while (ofs < max_ofs && key < a[hint - ofs]) {
+            last = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > max_ofs) {
+            ofs = max_ofs;
+        }
+        ptrdiff_t tmp = last;
+        last = hint - ofs;
+        ofs = hint - tmp;
+    } else {
+        ptrdiff_t max_ofs = n - hint;
+        while (ofs < max_ofs && !(key < a[hint + ofs])) {
+            last = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > max_ofs) {
+            ofs = max_ofs;
+        }
+        last += hint;
+        ofs += hint;
     }
 
-    for (int i = len - 1; i >= 1; i--) {
-        swap(arr, 0, i);
-        bubble_down(arr, i, 0);
+    /* a[last] <= key < a[ofs] */
+    last++;
+    while (last < ofs) {
+        ptrdiff_t mid = last + (ofs - last) / 2;
+        if (key < a[mid]) {
+            ofs = mid;
+        } else {
+            last = mid + 1;
+        }
     }
+
+    return ofs;
+}
+
+/* merges the adjacent runs a[0..na) and b[0..nb) front to back, where
+ * na <= nb. Only `a` is copied out of the way */
+static void merge_lo(struct tim_state *ts, int *a, size_t na, int *b,
+                     size_t nb)
+{
+    int *tmp = ts->tmp;
+    int *dest = a;
+    size_t i = 0, j = 0;
+    int min_gallop = ts->min_gallop;
+
+    memcpy(tmp, a, na * sizeof(int));
+
+    while (i < na && j < nb) {
+        int count_a = 0, count_b = 0;
+
+        /* one element at a time until a run wins min_gallop times in a row */
+        while (i < na && j < nb) {
+            if (b[j] < tmp[i]) {
+                *dest++ = b[j++];
+                count_a = 0;
+                if (++count_b >= min_gallop) {
+                    break;
+                }
+            } else {
+                *dest++ = tmp[i++];
+                count_b = 0;
+                if (++count_a >= min_gallop) {
+                    break;
+                }
+            }
+        }
+
+        /* then copy whole stretches found by galloping, for as long as they
+         * are long enough to pay off */
+        while (i < na && j < nb) {
+            size_t k_a = gallop_right(b[j], tmp + i, na - i, 0);
+            memcpy(dest, tmp + i, k_a * sizeof(int));
+            dest += k_a;
+            i += k_a;
+            if (i == na) {
+                break;
+            }
+
+            size_t k_b = gallop_left(tmp[i], b + j, nb - j, 0);
+            memmove(dest, b + j, k_b * sizeof(int));
+            dest += k_b;
+            j += k_b;
+            if (j == nb) {
+                break;
+            }
+
+            if (k_a < MIN_GALLOP && k_b < MIN_GALLOP) {
+                min_gallop++;
+                break;
+            }
+            if (min_gallop > 1) {
+                min_gallop--;
+            }
+        }
+    }
+
+    /* whatever is left of `b` is already in place */
+    memcpy(dest, tmp + i, (na - i) * sizeof(int));
+    ts->min_gallop = min_gallop;
+}
+
+/* merges the adjacent runs a[0..na) and b[0..nb) back to front, where
+ * nb <= na. Only `b` is copied out of the way */
+static void merge_hi(struct tim_state *ts, int *a, size_t na, int *b,
+                     size_t nb)
+{
+    int *tmp = ts->tmp;
+    int *dest = b + nb;
+    size_t i = na, j = nb;
+    int min_gallop = ts->min_gallop;
+
+    memcpy(tmp, b, nb * sizeof(int));
+
+    while (i > 0 && j > 0) {
+        int count_a = 0, count_b = 0;
+
+        while (i > 0 && j > 0) {
+            if (tmp[j - 1] < a[i - 1]) {
+                *--dest = a[--i];
+                count_b = 0;
+                if (++count_a >= min_gallop) {
+                    break;
+                }
+            } else {
+                *--dest = tmp[--j];
+                count_a = 0;
+                if (++count_b >= min_gallop) {
+                    break;
+                }
+            }
+        }
+
+        while (i > 0 && j > 0) {
+            size_t k_a = i - gallop_right(tmp[j - 1], a, i, i - 1);
+            dest -= k_a;
+            i -= k_a;
+            memmove(dest, a + i, k_a * sizeof(int));
+            if (i == 0) {
+                break;
+            }
+
+            size_t k_b = j - gallop_left(a[i - 1], tmp, j, j - 1);
+            dest -= k_b;
+            j -= k_b;
+            memcpy(dest, tmp + j, k_b * sizeof(int));
+            if (j == 0) {
+                break;
+            }
+
+            if (k_a < MIN_GALLOP && k_b < MIN_GALLOP) {
+                min_gallop++;
+                break;
+            }
+            if (min_gallop > 1) {
+                min_gallop--;
+            }
+        }
+    }
+
+    /* whatever is left of `a` is already in place */
+    memcpy(a, tmp, j * sizeof(int));
+    ts->min_gallop = min_gallop;
+}
+
+/* merges the i-th and (i + 1)-th runs on the stack */
+static void merge_at(struct tim_state *ts, int i)
+{
+    int *a = ts->arr + ts->run_base[i];
+    size_t na = ts->run_len[i];
+    int *b = ts->arr + ts->run_base[i + 1];
+    size_t nb = ts->run_len[i + 1];
+    size_t len = na + nb;
+
+    ts->run_len[i] = len;
+    if (i == ts->n_runs - 3) {
+        ts->run_base[i + 1] = ts->run_base[i + 2];
+        ts->run_len[i + 1] = ts->run_len[i + 2];
+    }
+    ts->n_runs--;
+
+    /* Elements of `a` no greater than b[0] and elements of `b` no less than
+     * the last of `a` are already in place */
+    size_t k = gallop_right(b[0], a, na, 0);
+    a += k;
+    na -= k;
+    if (na == 0) {
+        return;
+    }
+
+    nb = gallop_left(a[na - 1], b, nb, nb - 1);
+    if (nb == 0) {
+        return;
+    }
+
+    /* A quarter of the two runs already in place is the sign of runs that
+     * interleave in long stretches, which is what galloping is for. Otherwise
+     * the runs look random and a plain merge is much cheaper than counting
+     * the wins of each run. */
+    if ((len - na - nb) * 4 >= len && ts->min_gallop > MIN_GALLOP) {
+        ts->min_gallop = MIN_GALLOP;
+    }
+
+    if (ts->min_gallop > MIN_GALLOP) {
+        /* `b` directly follows `a`, so out + na == b, the one overlap that
+         * merge_into allows */
+        memcpy(ts->tmp, a, na * sizeof(int));
+        merge_into(ts->tmp, na, b, nb, a);
+    } else if (na <= nb) {
+        merge_lo(ts, a, na, b, nb);
+    } else {
+        merge_hi(ts, a, na, b, nb);
+    }
+}
+
+/* merges runs until the lengths X, Y, Z, W of the top four satisfy
+ * Z > Y + X, W > Z + Y and Y > X, which bounds both the stack depth and the
+ * total work to O(n log n) */
+static void merge_collapse(struct tim_state *ts)
+{
+    size_t *len = ts->run_len;
+
+    while (ts->n_runs > 1) {
+        int n = ts->n_runs - 2;
+
+        if ((n > 0 && len[n - 1] <= len[n] + len[n + 1])
+                || (n > 1 && len[n - 2] <= len[n - 1] + len[n])) {
+            if (len[n - 1] < len[n + 1]) {
+                n--;
+            }
+            merge_at(ts, n);
+        } else if (len[n] <= len[n + 1]) {
+            merge_at(ts, n);
+        } else {
+            break;
+        }
+    }
+}
+
+static void merge_force_collapse(struct tim_state *ts)
+{
+    size_t *len = ts->run_len;
+
+    while (ts->n_runs > 1) {
+        int n = ts->n_runs - 2;
+        if (n > 0 && len[n - 1] < len[n + 1]) {
+            n--;
+        }
+        merge_at(ts, n);
+    }
+}
+
+void tim_sort_sz(int *arr, size_t len)
+{
+    if (len < 2) {
+        return;
+    }
+
+    struct tim_state ts = {
+        .arr = arr,
+        .tmp = malloc(len * sizeof(int)),
+        .min_gallop = MIN_GALLOP + 1,
+        .n_runs = 0,
+    };
+    size_t min_run = min_run_length(len);
+
+    for (size_t start = 0; start < len;) {
+        size_t n = count_run(arr, start, len);
+
+        /* extend short runs to min_run elements */
+        if (n < min_run) {
+            n = len - start < min_run ? len - start : min_run;
+            small_sort(arr + start, n);
+        }
+
+        ts.run_base[ts.n_runs] = start;
+        ts.run_len[ts.n_runs] = n;
+        ts.n_runs++;
+        merge_collapse(&ts);
+
+        start += n;
+    }
+
+    merge_force_collapse(&ts);
+    free(ts.tmp);
+}
+
+static size_t partition(int *arr, size_t start, size_t end)
+{
+    int pivot = arr[start];
+    size_t next = end - 1;
+
+    for (size_t i = end - 1; i > start; i--) {
+        if (arr[i] > pivot) {
+            swap(arr, next--, i);
+        }
+    }
+
+    swap(arr, start, next);
+    return next;
+}
+
+/* ranges longer than this pick their pivot with Tukey's ninther */
+#define NINTHER_THRESHOLD 128
+
+/* returns the index of the median of arr[a], arr[b] and arr[c] */
+static size_t median_of_three(int *arr, size_t a, size_t b, size_t c)
+{
+    if (arr[a] < arr[b]) {
+        if (arr[b] < arr[c]) {
+            return b;
+        }
+        return arr[a] < arr[c] ? c : a;
+    } else {
+        if (arr[a] < arr[c]) {
+            return a;
+        }
+        return arr[b] < arr[c] ? c : b;
+    }
+}
+
+static size_t choose_pivot(int *arr, size_t start, size_t end)
+{
+    size_t len = end - start;
+    size_t mid = start + len / 2;
+
+    if (len > NINTHER_THRESHOLD) {
+        size_t s = len / 8;
+        size_t lo = median_of_three(arr, start, start + s, start + 2 * s);
+        size_t md = median_of_three(arr, mid - s, mid, mid + s);
+        size_t hi = median_of_three(arr, end - 1 - 2 * s, end - 1 - s,
+                                    end - 1);
+        return median_of_three(arr, lo, md, hi);
+    }
+
+    return median_of_three(arr, start, mid, end - 1);
+}
+
+/* partitions arr[start..end) around arr[start] and returns the final index of
+ * the pivot. Everything before it is <= the pivot, everything after >= */
+typedef size_t (*partition_fn)(int *arr, size_t start, size_t end);
+
+static void quick_sort_impl(int *arr, size_t start, size_t end,
+                            int depth_limit, partition_fn kernel)
+{
+    /* a sorting network handles leaves of 32 in about the time insertion sort
+     * takes for 16 */
+    size_t leaf = network_available() ? NETWORK_MAX : INSERTION_THRESHOLD;
+
+    while (end - start > leaf) {
+        if (depth_limit-- == 0) {
+            heap_sort_sz(arr + start, end - start);
+            return;
+        }
+
+        swap(arr, start, choose_pivot(arr, start, end));
+        size_t p = kernel(arr, start, end);
+
+        /* Recurse into the smaller side and loop on the larger one so that the
+         * stack depth stays O(log n) */
+        if (p - start < end - p - 1) {
+            quick_sort_impl(arr, start, p, depth_limit, kernel);
+            start = p + 1;
+        } else {
+            quick_sort_impl(arr, p + 1, end, depth_limit, kernel);
+            end = p;
+        }
+    }
+
+    small_sort(arr + start, end - start);
+}
+
+static int depth_limit_for(size_t len)
+{
+    int depth_limit = 0;
+    for (size_t n = len; n > 1; n >>= 1) {
+        depth_limit += 2;
+    }
+
+    return depth_limit;
+}
+
+/* introsort: quick sort that gives up on bad pivots after 2 * log2(len) levels
+ * and heap sorts the rest of the range instead */
+void quick_sort_sz(int *arr, size_t len)
+{
+    quick_sort_impl(arr, 0, len, depth_limit_for(len), partition);
+}
+
+/* the number of elements block_partition classifies at a time */
+#define BLOCK_SIZE 64
+
+/* BlockQuicksort-style partition: the comparisons of a whole block are stored
+ * as offsets without branching, and the misplaced elements are swapped
+ * pairwise afterwards. Like a Hoare partition, keys equal to the pivot are
+ * moved from both sides, so duplicates are split evenly. */
+static size_t block_partition(int *arr, size_t start, size_t end)
+{
+    int pivot = arr[start];
+    unsigned char offsets_l[BLOCK_SIZE], offsets_r[BLOCK_SIZE];
+    int start_l = 0, num_l = 0, start_r = 0, num_r = 0;
+
+    /* arr[start + 1 .. l) <= pivot and arr(r .. end) >= pivot */
+    size_t l = start + 1, r = end - 1;
+
+    while (l + 2 * BLOCK_SIZE <= r + 1) {
+        if (num_l == 0) {
+            start_l = 0;
+            for (int i = 0; i < BLOCK_SIZE; i++) {
+                offsets_l[num_l] = i;
+                num_l += arr[l + i] >= pivot;
+            }
+        }
+
+        if (num_r == 0) {
+            start_r = 0;
+            for (int i = 0; i < BLOCK_SIZE; i++) {
+                offsets_r[num_r] = i;
+                num_r += arr[r - i] <= pivot;
+            }
+        }
+
+        int num = num_l < num_r ? num_l : num_r;
+        for (int k = 0; k < num; k++) {
+            swap(arr, l + offsets_l[start_l + k], r - offsets_r[start_r + k]);
+        }
+
+        num_l -= num;
+        num_r -= num;
+        start_l += num;
+        start_r += num;
+
+        if (num_l == 0) {
+            l += BLOCK_SIZE;
+        }
+        if (num_r == 0) {
+            r -= BLOCK_SIZE;
+        }
+    }
+
+    /* Finish the rest, including a block that is only partly done, with a
+     * plain Hoare partition */
+    size_t i = l - 1, j = r + 1;
+    for (;;) {
+        while (arr[++i] < pivot) {
+            if (i == end - 1) {
+                break;
+            }
+        }
+        while (pivot < arr[--j]);
+        if (i >= j) {
+            break;
+        }
+        swap(arr, i, j);
+    }
+
+    swap(arr, start, j);
+    return j;
+}
+
+/* introsort on block_partition instead of partition */
+void block_quick_sort_sz(int *arr, size_t len)
+{
+    quick_sort_impl(arr, 0, len, depth_limit_for(len), block_partition);
+}
+
+/* Dijkstra's three-way partition around arr[start]. Afterwards,
+ * arr[start..*lt_p) < pivot, arr[*lt_p..*gt_p) == pivot and
+ * arr[*gt_p..end) > pivot */
+static void partition3(int *arr, size_t start, size_t end, size_t *lt_p,
+                       size_t *gt_p)
+{
+    int pivot = arr[start];
+    size_t lt = start, i = start + 1, gt = end;
+
+    while (i < gt) {
+        if (arr[i] < pivot) {
+            swap(arr, lt++, i++);
+        } else if (arr[i] > pivot) {
+            swap(arr, i, --gt);
+        } else {
+            i++;
+        }
+    }
+
+    *lt_p = lt;
+    *gt_p = gt;
+}
+
+static void quick_sort_3way_impl(int *arr, size_t start, size_t end,
+                                 int depth_limit)
+{
+    while (end - start > INSERTION_THRESHOLD) {
+        if (depth_limit-- == 0) {
+            heap_sort_sz(arr + start, end - start);
+            return;
+        }
+
+        swap(arr, start, choose_pivot(arr, start, end));
+        size_t lt, gt;
+        partition3(arr, start, end, &lt, &gt);
+
+        /* keys equal to the pivot are already in place and never looked at
+         * again */
+        if (lt - start < end - gt) {
+            quick_sort_3way_impl(arr, start, lt, depth_limit);
+            start = gt;
+        } else {
+            quick_sort_3way_impl(arr, gt, end, depth_limit);
+            end = lt;
+        }
+    }
+
+    insertion_sort_sz(arr + start, end - start);
+}
+
+/* introsort on a three-way partition, for inputs with many duplicates */
+void quick_sort_3way_sz(int *arr, size_t len)
+{
+    quick_sort_3way_impl(arr, 0, len, depth_limit_for(len));
+}
+
+static void bubble_up(int *arr, size_t i)
+{
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+
+        if (arr[parent] < arr[i]) {
+            swap(arr, parent, i);
+            i = parent;
+        } else {
+            break;
+        }
+    }
+}
+
+static void bubble_down(int *arr, size_t len, size_t i)
+{
+    for (;;) {
+        size_t largest = i;
+        size_t left = 2 * i + 1;
+        size_t right = 2 * i + 2;
+
+        if (left < len && arr[left] > arr[largest]) {
+            largest = left;
+        }
+
+        if (right < len && arr[right] > arr[largest]) {
+            largest = right;
+        }
+
+        if (largest != i) {
+            swap(arr, i, largest);
+            i = largest;
+        } else {
+            break;
+        }
+    }
+}
+
+void heap_sort_sz(int *arr, size_t len)
+{
+    for (size_t i = len / 2; i-- > 0;) {
+        bubble_down(arr, len, i);
+    }
+
+    for (size_t i = len; i-- > 1;) {
+        swap(arr, 0, i);
+        bubble_down(arr, i, 0);
+    }
+}
+
+/* Floyd's sift-down: walks the hole at arr[i] down to a leaf along the larger
+ * children, then climbs back up to where the sifted value belongs. The value
+ * usually belongs near the bottom, so this takes about one comparison per
+ * level instead of two. */
+static void sift_down_floyd(int *arr, size_t len, size_t i)
+{
+    int x = arr[i];
+    size_t top = i;
+
+    for (size_t child = 2 * i + 1; child < len; child = 2 * i + 1) {
+        if (child + 1 < len && arr[child + 1] > arr[child]) {
+            child++;
+        }
+        arr[i] = arr[child];
+        i = child;
+    }
+
+    while (i > top) {
+        size_t parent = (i - 1) / 2;
+        if (arr[parent] >= x) {
+            break;
+        }
+        arr[i] = arr[parent];
+        i = parent;
+    }
+
+    arr[i] = x;
+}
+
+void heap_sort_bottom_up_sz(int *arr, size_t len)
+{
+    for (size_t i = len / 2; i-- > 0;) {
+        sift_down_floyd(arr, len, i);
+    }
+
+    for (size_t i = len; i-- > 1;) {
+        swap(arr, 0, i);
+        sift_down_floyd(arr, i, 0);
+    }
+}
+
+/* the number of children of a node in heap_sort_dary. The four children of a
+ * node are 16 contiguous bytes, so they share a cache line most of the time,
+ * and the heap is half as deep as a binary one. */
+#define HEAP_ARITY 4
+
+static void sift_down_dary(int *arr, size_t len, size_t i)
+{
+    int x = arr[i];
+
+    for (;;) {
+        size_t first = HEAP_ARITY * i + 1;
+        if (first >= len) {
+            break;
+        }
+
+        size_t last = len - first < HEAP_ARITY ? len : first + HEAP_ARITY;
+        size_t largest = first;
+        for (size_t c = first + 1; c < last; c++) {
+            if (arr[c] > arr[largest]) {
+                largest = c;
+            }
+        }
+
+        if (arr[largest] <= x) {
+            break;
+        }
+        arr[i] = arr[largest];
+        i = largest;
+    }
+
+    arr[i] = x;
+}
+
+void heap_sort_dary_sz(int *arr, size_t len)
+{
+    if (len < 2) {
+        return;
+    }
+
+    for (size_t i = (len - 2) / HEAP_ARITY + 1; i-- > 0;) {
+        sift_down_dary(arr, len, i);
+    }
+
+    for (size_t i = len; i-- > 1;) {
+        swap(arr, 0, i);
+        sift_down_dary(arr, i, 0);
+    }
+}
+
+/******************************************************************************/
+/*                                 Selection                                  */
+/******************************************************************************/
+
+static void select_impl(int *arr, size_t start, size_t end, size_t k);
+
+/* BFPRT pivot: moves the medians of groups of five to the front of the range
+ * and returns the index of their median, which is guaranteed to have at least
+ * 30% of the range on either side */
+static size_t median_of_medians(int *arr, size_t start, size_t end)
+{
+    size_t n_groups = 0;
+
+    for (size_t i = start; i < end; i += 5) {
+        size_t n = end - i < 5 ? end - i : 5;
+        insertion_sort_sz(arr + i, n);
+        swap(arr, start + n_groups++, i + n / 2);
+    }
+
+    size_t mid = start + n_groups / 2;
+    select_impl(arr, start, start + n_groups, mid);
+    return mid;
+}
+
+/* introselect: quickselect on a three-way partition. Whenever a partition
+ * keeps more than half of the range, the next pivot is a median of medians,
+ * which keeps at most 70% of it. The range thus shrinks by a constant factor
+ * every two rounds at most, making it linear in the worst case. */
+static void select_impl(int *arr, size_t start, size_t end, size_t k)
+{
+    bool guarantee = false; /* whether the last round kept more than half */
+
+    while (end - start > INSERTION_THRESHOLD) {
+        size_t len = end - start;
+        size_t pivot = guarantee ? median_of_medians(arr, start, end)
+                                 : choose_pivot(arr, start, end);
+        swap(arr, start, pivot);
+
+        size_t lt, gt;
+        partition3(arr, start, end, &lt, &gt);
+
+        if (k < lt) {
+            end = lt;
+        } else if (k >= gt) {
+            start = gt;
+        } else {
+            return;
+        }
+
+        guarantee = end - start > len / 2;
+    }
+
+    insertion_sort_sz(arr + start, end - start);
+}
+
+int select_nth_sz(int *arr, size_t len, size_t k)
+{
+    assert(k < len);
+    select_impl(arr, 0, len, k);
+    return arr[k];
+}
+
+void partial_sort_sz(int *arr, size_t len, size_t k)
+{
+    if (k == 0) {
+        return;
+    }
+
+    if (k < len) {
+        select_nth_sz(arr, len, k - 1);
+    } else {
+        k = len;
+    }
+
+    quick_sort_sz(arr, k);
+}
+
+/* representation of a streaming top-k: a max-heap of the k smallest values
+ * seen so far, so the largest of them can be evicted in O(log k) */
+struct topk {
+    int k;
+    int len;
+    int heap[];
+};
+
+/* pushes x into the max-heap heap[0..*len) of at most k values */
+static void bounded_heap_push(int *heap, int *len, int k, int x)
+{
+    if (*len < k) {
+        heap[*len] = x;
+        bubble_up(heap, (*len)++);
+    } else if (*len > 0 && x < heap[0]) {
+        heap[0] = x;
+        bubble_down(heap, *len, 0);
+    }
+}
+
+struct topk *topk_create(int k)
+{
+    assert(k >= 0);
+
+    struct topk *t = malloc(sizeof(*t) + k * sizeof(t->heap[0]));
+    if (t == NULL) {
+        return NULL;
+    }
+    t->k = k;
+    t->len = 0;
+
+    return t;
+}
+
+void topk_free(struct topk *t)
+{
+    free(t);
+}
+
+void topk_push(struct topk *t, int x)
+{
+    bounded_heap_push(t->heap, &t->len, t->k, x);
+}
+
+int topk_result(struct topk *t, int *out)
+{
+    memcpy(out, t->heap, t->len * sizeof(int));
+    heap_sort_sz(out, t->len);
+
+    return t->len;
+}
+
+/* the heap of a topk, kept in `out` itself: it never holds more than the
+ * min(k, len) values that end up there, and nothing is allocated */
+int top_k_sz(const int *arr, size_t len, int k, int *out)
+{
+    assert(k >= 0);
+
+    int n = 0;
+    for (size_t i = 0; i < len; i++) {
+        bounded_heap_push(out, &n, k, arr[i]);
+    }
+
+    heap_sort_sz(out, n);
+    return n;
+}
+
+/* radix_sort processes keys RADIX_BITS bits at a time */
+#define RADIX_BITS 8
+#define RADIX (1 << RADIX_BITS)
+#define RADIX_DIGITS (32 / RADIX_BITS)
+
+/* maps INT_MIN..INT_MAX onto 0..UINT_MAX in order by flipping the sign bit, so
+ * that negative numbers sort before positive ones */
+static inline unsigned radix_key(int x)
+{
+    return (unsigned) x ^ 0x80000000u;
+}
+
+void radix_sort_sz(int *arr, size_t len)
+{
+    if (len <= 1) {
+        return;
+    }
+
+    /* Count the histograms of all digits in a single pass */
+    size_t counts[RADIX_DIGITS][RADIX] = { { 0 } };
+    for (size_t i = 0; i < len; i++) {
+        unsigned key = radix_key(arr[i]);
+        for (int d = 0; d < RADIX_DIGITS; d++) {
+            counts[d][(key >> (d * RADIX_BITS)) & (RADIX - 1)]++;
+        }
+    }
+
+    int *scratch = malloc(len * sizeof(int));
+    int *src = arr, *dst = scratch;
+    unsigned first = radix_key(arr[0]);
+
+    for (int d = 0; d < RADIX_DIGITS; d++) {
+        int shift = d * RADIX_BITS;
+
+        /* Skip digits that are the same across the whole input, e.g. the high
+         * bytes of small non-negative numbers */
+        if (counts[d][(first >> shift) & (RADIX - 1)] == len) {
+            continue;
+        }
+
+        size_t offsets[RADIX];
+        size_t sum = 0;
+        for (int b = 0; b < RADIX; b++) {
+            offsets[b] = sum;
+            sum += counts[d][b];
+        }
+
+        for (size_t i = 0; i < len; i++) {
+            dst[offsets[(radix_key(src[i]) >> shift) & (RADIX - 1)]++] = src[i];
+        }
+
+        int *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != arr) {
+        memcpy(arr, src, len * sizeof(int));
+    }
+
+    free(scratch);
+}
+
+/******************************************************************************/
+/*                               Counting sort                                */
+/******************************************************************************/
+
+/* counting sort is used while there are at least this many elements per
+ * possible value. With fewer, the increments of the histogram miss the cache so
+ * often that radix sort is faster. */
+#define COUNTING_MIN_DENSITY 2
+
+/* min_max keeps this many minimums and maximums side by side, which compilers
+ * vectorize even where they would not reassociate a single one */
+#define MIN_MAX_LANES 8
+
+/* the smallest and largest value of a non-empty array */
+static void min_max(const int *arr, size_t len, int *min_p, int *max_p)
+{
+    int min[MIN_MAX_LANES], max[MIN_MAX_LANES];
+    for (int j = 0; j < MIN_MAX_LANES; j++) {
+        min[j] = max[j] = arr[0];
+    }
+
+    size_t i = 0;
+    for (; i + MIN_MAX_LANES <= len; i += MIN_MAX_LANES) {
+        for (int j = 0; j < MIN_MAX_LANES; j++) {
+            min[j] = arr[i + j] < min[j] ? arr[i + j] : min[j];
+            max[j] = arr[i + j] > max[j] ? arr[i + j] : max[j];
+        }
+    }
+    for (; i < len; i++) {
+        min[0] = arr[i] < min[0] ? arr[i] : min[0];
+        max[0] = arr[i] > max[0] ? arr[i] : max[0];
+    }
+
+    for (int j = 1; j < MIN_MAX_LANES; j++) {
+        min[0] = min[j] < min[0] ? min[j] : min[0];
+        max[0] = max[j] > max[0] ? max[j] : max[0];
+    }
+
+    *min_p = min[0];
+    *max_p = max[0];
+}
+
+static size_t value_range(int min, int max)
+{
+    return (size_t) ((int64_t) max - min) + 1;
+}
+
+static bool counting_pays_off(size_t len, size_t range)
+{
+    return range <= len / COUNTING_MIN_DENSITY;
+}
+
+/* writes counts[v] copies of min + v for every v in [start, end), from `out`
+ * on */
+static void write_counts(int *out, const size_t *counts, int min, size_t start,
+                         size_t end)
+{
+    for (size_t v = start; v < end; v++) {
+        int x = (int) (min + (int64_t) v);
+        for (size_t n = counts[v]; n > 0; n--) {
+            *out++ = x;
+        }
+    }
+}
+
+/* sorts values in [min, min + range) by counting how often each occurs */
+static void counting_sort_range(int *arr, size_t len, int min, size_t range)
+{
+    size_t *counts = calloc(range, sizeof(*counts));
+
+    for (size_t i = 0; i < len; i++) {
+        counts[(int64_t) arr[i] - min]++;
+    }
+
+    write_counts(arr, counts, min, 0, range);
+
+    free(counts);
+}
+
+void counting_sort_sz(int *arr, size_t len)
+{
+    if (len < 2) {
+        return;
+    }
+
+    int min, max;
+    min_max(arr, len, &min, &max);
+
+    size_t range = value_range(min, max);
+    if (counting_pays_off(len, range)) {
+        counting_sort_range(arr, len, min, range);
+    } else {
+        radix_sort_sz(arr, len);
+    }
+}
+
+/* A parallel counting sort cuts the array into one chunk per task and counts
+ * every chunk into a histogram of its own, so that the tasks never write to
+ * the same counter. Then it cuts the range of values into as many slices, and
+ * every task adds up the histograms over one slice and writes out its
+ * values. */
+struct pcount {
+    struct tpool *pool;
+    int *arr;
+    size_t len;
+    int ntasks;
+    int min;
+    size_t range;        /* 0 if counting sort does not pay off */
+    int *mins;           /* the minimum of every chunk */
+    int *maxs;           /* the maximum of every chunk */
+    size_t **counts;     /* the histogram of every chunk */
+    size_t *slice_start; /* where the values of every slice are written */
+};
+
+struct pcount_task {
+    struct pcount *p;
+    int i;
+};
+
+/* the start of part i of `total` things cut into n parts */
+static size_t part_start(size_t total, int n, int i)
+{
+    size_t part = (total + n - 1) / n;
+    return i * part < total ? i * part : total;
+}
+
+static void pcount_min_max_task(void *arg)
+{
+    struct pcount_task *t = arg;
+    struct pcount *p = t->p;
+
+    size_t start = part_start(p->len, p->ntasks, t->i);
+    size_t end = part_start(p->len, p->ntasks, t->i + 1);
+    min_max(p->arr + start, end - start, &p->mins[t->i], &p->maxs[t->i]);
+}
+
+static void pcount_count_task(void *arg)
+{
+    struct pcount_task *t = arg;
+    struct pcount *p = t->p;
+
+    /* allocated by the task itself, so that its pages are cleared in parallel
+     * and, on NUMA machines, close to the thread that uses them */
+    size_t *counts = calloc(p->range, sizeof(*counts));
+    size_t start = part_start(p->len, p->ntasks, t->i);
+    size_t end = part_start(p->len, p->ntasks, t->i + 1);
+
+    p->counts[t->i] = counts;
+    if (counts == NULL) {
+        return;
+    }
+
+    for (size_t i = start; i < end; i++) {
+        counts[(int64_t) p->arr[i] - p->min]++;
+    }
+}
+
+/* adds the other histograms into the first one over slice i of the range and
+ * stores the size of the slice in slice_start[i] */
+static void pcount_merge_task(void *arg)
+{
+    struct pcount_task *t = arg;
+    struct pcount *p = t->p;
+
+    size_t start = part_start(p->range, p->ntasks, t->i);
+    size_t end = part_start(p->range, p->ntasks, t->i + 1);
+    size_t total = 0;
+
+    for (size_t v = start; v < end; v++) {
+        size_t n = p->counts[0][v];
+        for (int c = 1; c < p->ntasks; c++) {
+            n += p->counts[c][v];
+        }
+        p->counts[0][v] = n;
+        total += n;
+    }
+
+    p->slice_start[t->i] = total;
+}
+
+static void pcount_write_task(void *arg)
+{
+    struct pcount_task *t = arg;
+    struct pcount *p = t->p;
+
+    size_t start = part_start(p->range, p->ntasks, t->i);
+    size_t end = part_start(p->range, p->ntasks, t->i + 1);
+    write_counts(p->arr + p->slice_start[t->i], p->counts[0], p->min, start,
+                 end);
+}
+
+/* runs fn on every task in parallel and waits for all of them */
+static void pcount_phase(struct pcount *p, struct pcount_task *tasks,
+                         void (*fn)(void *arg))
+{
+    struct tpool_join join = { 0 };
+
+    for (int i = 1; i < p->ntasks; i++) {
+        tpool_spawn(p->pool, &join, fn, &tasks[i]);
+    }
+    fn(&tasks[0]);
+
+    tpool_wait(p->pool, &join);
+}
+
+/* sorts p->arr with a histogram per task. Returns false, having changed
+ * nothing, if the histograms do not fit in memory. */
+static bool pcount_histograms(struct pcount *p, struct pcount_task *tasks)
+{
+    pcount_phase(p, tasks, pcount_count_task);
+
+    bool allocated = true;
+    for (int i = 0; i < p->ntasks; i++) {
+        allocated = allocated && p->counts[i] != NULL;
+    }
+    if (!allocated) {
+        for (int i = 0; i < p->ntasks; i++) {
+            free(p->counts[i]);
+        }
+        return false;
+    }
+
+    pcount_phase(p, tasks, pcount_merge_task);
+
+    /* the sizes of the slices become their starts */
+    size_t start = 0;
+    for (int i = 0; i < p->ntasks; i++) {
+        size_t size = p->slice_start[i];
+        p->slice_start[i] = start;
+        start += size;
+    }
+
+    pcount_phase(p, tasks, pcount_write_task);
+
+    for (int i = 0; i < p->ntasks; i++) {
+        free(p->counts[i]);
+    }
+
+    return true;
+}
+
+static void pcount_root(void *arg)
+{
+    struct pcount *p = arg;
+    struct pcount_task *tasks = malloc(p->ntasks * sizeof(*tasks));
+    for (int i = 0; i < p->ntasks; i++) {
+        tasks[i] = (struct pcount_task) { p, i };
+    }
+
+    pcount_phase(p, tasks, pcount_min_max_task);
+
+    int min = p->mins[0], max = p->maxs[0];
+    for (int i = 1; i < p->ntasks; i++) {
+        min = p->mins[i] < min ? p->mins[i] : min;
+        max = p->maxs[i] > max ? p->maxs[i] : max;
+    }
+
+    /* decided on the whole array, as counting_sort_sz does, so that the
+     * number of tasks never changes which algorithm sorts it */
+    size_t range = value_range(min, max);
+    if (counting_pays_off(p->len, range)) {
+        p->min = min;
+        p->range = range;
+
+        /* Every task clears a whole histogram of its own and the merge adds
+         * up all of them, which pays off only if the chunk of every task is
+         * dense enough by itself. Otherwise one histogram does, which also
+         * bounds the memory to that of the serial sort. */
+        if (!counting_pays_off(p->len / p->ntasks, range)
+                || !pcount_histograms(p, tasks)) {
+            counting_sort_range(p->arr, p->len, min, range);
+        }
+    }
+
+    free(tasks);
+}
+
+void parallel_counting_sort_sz(int *arr, size_t len, int nthreads)
+{
+    /* chunks smaller than PARALLEL_CUTOFF are not worth a task */
+    size_t max_tasks = len / PARALLEL_CUTOFF;
+    if (nthreads <= 1 || max_tasks <= 1) {
+        counting_sort_sz(arr, len);
+        return;
+    }
+
+    int ntasks = (size_t) nthreads < max_tasks ? nthreads : (int) max_tasks;
+    struct pcount p = {
+        .pool = tpool_create(ntasks),
+        .arr = arr,
+        .len = len,
+        .ntasks = ntasks,
+        .mins = malloc(ntasks * sizeof(int)),
+        .maxs = malloc(ntasks * sizeof(int)),
+        .counts = malloc(ntasks * sizeof(size_t *)),
+        .slice_start = malloc(ntasks * sizeof(size_t)),
+    };
+
+    tpool_run(p.pool, pcount_root, &p);
+    tpool_free(p.pool);
+
+    free(p.mins);
+    free(p.maxs);
+    free(p.counts);
+    free(p.slice_start);
+
+    if (p.range == 0) {
+        radix_sort_sz(arr, len);
+    }
+}
+
+/******************************************************************************/
+/*                             Automatic dispatch                             */
+/******************************************************************************/
+
+const char *const SORT_AUTO_NAMES[N_SORT_AUTO] = {
+    [SORT_AUTO_NONE] = "already sorted",
+    [SORT_AUTO_REVERSE] = "reversed",
+    [SORT_AUTO_INSERTION] = "insertion sort",
+    [SORT_AUTO_TIM] = "tim sort",
+    [SORT_AUTO_COUNTING] = "counting sort",
+    [SORT_AUTO_RADIX] = "radix sort",
+    [SORT_AUTO_QUICK] = "block quick sort",
+    [SORT_AUTO_QUICK_3WAY] = "3-way quick sort",
+};
+
+/* sort_auto looks for runs in up to AUTO_WINDOWS windows of AUTO_WINDOW
+ * consecutive elements, evenly spread over the array */
+#define AUTO_WINDOWS 16
+#define AUTO_WINDOW 16
+
+/* tim sort is chosen if at least this fraction of the windows are runs */
+#define AUTO_RUNS_MIN 0.75
+
+/* arrays of up to AUTO_INSERTION_MAX elements with at most this fraction of
+ * descents among the sampled neighbours are nearly sorted, and insertion sort
+ * only has a few elements to move */
+#define AUTO_DESCENTS_MAX (1.0 / 16)
+#define AUTO_INSERTION_MAX 256
+
+/* the duplicate rate is estimated from this many evenly spread elements */
+#define AUTO_DISTINCT_SAMPLE 16
+
+/* 3-way quick sort is chosen over block quick sort if at most this fraction
+ * of the sample is distinct */
+#define AUTO_DISTINCT_MAX 0.5
+
+/* below this many elements, sampling costs more than the best choice can
+ * save: such arrays only get insertion sort if they are nearly sorted as a
+ * whole, and block quick sort otherwise */
+#define AUTO_SAMPLE_MIN 64
+
+/* radix sort's fixed costs, its histograms and its scratch buffer, only pay
+ * off from this many elements on */
+#define AUTO_RADIX_MIN 256
+
+/* sets stats->runs to the fraction of the sampled windows that are ascending
+ * or descending, give or take one element out of place, and stats->descents to
+ * the fraction of sampled neighbours that are in descending order */
+static void sample_runs(const int *arr, size_t len,
+                        struct sort_auto_stats *stats)
+{
+    size_t n_windows = len / AUTO_WINDOW;
+    if (n_windows > AUTO_WINDOWS) {
+        n_windows = AUTO_WINDOWS;
+    }
+
+    /* the first window is at the start and the last one at the end */
+    size_t step = n_windows > 1 ? (len - AUTO_WINDOW) / (n_windows - 1) : 0;
+    size_t n_runs = 0, n_descents = 0;
+
+    for (size_t w = 0; w < n_windows; w++) {
+        const int *win = arr + w * step;
+        int descents = 0;
+        for (int i = 1; i < AUTO_WINDOW; i++) {
+            descents += win[i - 1] > win[i];
+        }
+
+        n_runs += descents <= 1 || descents >= AUTO_WINDOW - 2;
+        n_descents += descents;
+    }
+
+    stats->runs = (double) n_runs / n_windows;
+    stats->descents = (double) n_descents / (n_windows * (AUTO_WINDOW - 1));
+}
+
+/* the fraction of distinct values in a small sample. Comparing all pairs
+ * without branches is cheaper than sorting the sample at this size. */
+static double sample_distinct(const int *arr, size_t len)
+{
+    int sample[AUTO_DISTINCT_SAMPLE];
+    size_t step = len / AUTO_DISTINCT_SAMPLE;
+    int distinct = 0;
+
+    for (int i = 0; i < AUTO_DISTINCT_SAMPLE; i++) {
+        sample[i] = arr[i * step];
+
+        int seen = 0;
+        for (int j = 0; j < i; j++) {
+            seen |= sample[j] == sample[i];
+        }
+        distinct += !seen;
+    }
+
+    return (double) distinct / AUTO_DISTINCT_SAMPLE;
+}
+
+/* fills in *stats and the choice of algorithm in it. The cheapest tests come
+ * first, and every feature is only computed if the choice still depends on
+ * it. */
+static void sort_auto_choose(const int *arr, size_t len,
+                             struct sort_auto_stats *stats)
+{
+    *stats = (struct sort_auto_stats) {
+        .len = len,
+        .runs = -1,
+        .descents = -1,
+        .distinct = -1,
+    };
+
+    if (len <= INSERTION_THRESHOLD) {
+        stats->choice = SORT_AUTO_INSERTION;
+        return;
+    }
+
+    /* sorted and reversed arrays are common enough to look for first; on other
+     * input, the scan stops after a few elements */
+    size_t run = 1;
+    if (arr[0] <= arr[1]) {
+        while (run < len && arr[run - 1] <= arr[run]) {
+            run++;
+        }
+        if (run == len) {
+            stats->choice = SORT_AUTO_NONE;
+            return;
+        }
+    } else {
+        while (run < len && arr[run - 1] > arr[run]) {
+            run++;
+        }
+        if (run == len) {
+            stats->choice = SORT_AUTO_REVERSE;
+            return;
+        }
+    }
+
+    if (len < AUTO_SAMPLE_MIN) {
+        size_t descents = 0;
+        for (size_t i = 1; i < len; i++) {
+            descents += arr[i - 1] > arr[i];
+        }
+
+        stats->descents = (double) descents / (len - 1);
+        stats->choice = stats->descents <= AUTO_DESCENTS_MAX
+                            ? SORT_AUTO_INSERTION : SORT_AUTO_QUICK;
+        return;
+    }
+
+    sample_runs(arr, len, stats);
+    if (stats->descents <= AUTO_DESCENTS_MAX && len <= AUTO_INSERTION_MAX) {
+        stats->choice = SORT_AUTO_INSERTION;
+        return;
+    }
+    if (stats->runs >= AUTO_RUNS_MIN) {
+        stats->choice = SORT_AUTO_TIM;
+        return;
+    }
+
+    min_max(arr, len, &stats->min, &stats->max);
+    stats->range = value_range(stats->min, stats->max);
+    if (counting_pays_off(len, stats->range)) {
+        stats->choice = SORT_AUTO_COUNTING;
+        return;
+    }
+    if (len >= AUTO_RADIX_MIN) {
+        stats->choice = SORT_AUTO_RADIX;
+        return;
+    }
+
+    stats->distinct = sample_distinct(arr, len);
+    stats->choice = stats->distinct <= AUTO_DISTINCT_MAX ? SORT_AUTO_QUICK_3WAY
+                                                         : SORT_AUTO_QUICK;
+}
+
+void sort_auto_debug(int *arr, size_t len, struct sort_auto_stats *stats)
+{
+    sort_auto_choose(arr, len, stats);
+
+    switch (stats->choice) {
+    case SORT_AUTO_NONE:
+        break;
+    case SORT_AUTO_REVERSE:
+        reverse(arr, 0, len);
+        break;
+    case SORT_AUTO_INSERTION:
+        insertion_sort_sz(arr, len);
+        break;
+    case SORT_AUTO_TIM:
+        tim_sort_sz(arr, len);
+        break;
+    case SORT_AUTO_COUNTING:
+        counting_sort_range(arr, len, stats->min, stats->range);
+        break;
+    case SORT_AUTO_RADIX:
+        radix_sort_sz(arr, len);
+        break;
+    case SORT_AUTO_QUICK:
+        block_quick_sort_sz(arr, len);
+        break;
+    case SORT_AUTO_QUICK_3WAY:
+        quick_sort_3way_sz(arr, len);
+        break;
+    default:
+        break;
+    }
+}
+
+void sort_auto_sz(int *arr, size_t len)
+{
+    struct sort_auto_stats stats;
+    sort_auto_debug(arr, len, &stats);
+}
+
+/******************************************************************************/
+/*                              String sorting                                */
+/******************************************************************************/
+
+#define STRING_KEY(s) (s)
+
+STRING_SORT_DEFINE(multikey_sort, char *, STRING_KEY)
+
+void string_sort_sz(char **strs, size_t len)
+{
+    multikey_sort(strs, len);
+}
+
+/******************************************************************************/
+/*                              Generic sorting                               */
+/******************************************************************************/
+
+typedef int (*generic_cmp)(const void *, const void *);
+
+#define GENERIC_LESS(a, b, cmp) ((cmp)(&(a), &(b)) < 0)
+
+/* 4- and 8-byte elements are moved as integers rather than byte by byte.
+ * They are really objects of the caller's type, e.g. floats or doubles, which
+ * cmp reads them as, so the integer types have to be allowed to alias it: with
+ * strict aliasing, the compiler could otherwise move the integer loads and
+ * stores past the calls to cmp. */
+typedef uint32_t __attribute__((may_alias)) generic_word32;
+typedef uint64_t __attribute__((may_alias)) generic_word64;
+
+SORT_DEFINE_CTX(generic_sort_32, generic_word32, generic_cmp, GENERIC_LESS)
+SORT_DEFINE_CTX(generic_sort_64, generic_word64, generic_cmp, GENERIC_LESS)
+
+static void swap_bytes(char *a, char *b, size_t size)
+{
+    char tmp[64];
+
+    while (size > 0) {
+        size_t n = size < sizeof(tmp) ? size : sizeof(tmp);
+        memcpy(tmp, a, n);
+        memcpy(a, b, n);
+        memcpy(b, tmp, n);
+        a += n;
+        b += n;
+        size -= n;
+    }
+}
+
+static void generic_sift_down(char *base, size_t len, size_t i, size_t size,
+                              generic_cmp cmp)
+{
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= len) {
+            break;
+        }
+        if (child + 1 < len
+                && cmp(base + child * size, base + (child + 1) * size) < 0) {
+            child++;
+        }
+        if (cmp(base + i * size, base + child * size) >= 0) {
+            break;
+        }
+        swap_bytes(base + i * size, base + child * size, size);
+        i = child;
+    }
+}
+
+/* the byte-wise counterpart of the sorts generated by sort-template.h */
+static void generic_sort_bytes(char *base, size_t len, size_t size,
+                               int depth_limit, generic_cmp cmp)
+{
+    while (len > SORT_TEMPLATE_INSERTION) {
+        if (depth_limit-- == 0) {
+            for (size_t i = len / 2; i-- > 0;) {
+                generic_sift_down(base, len, i, size, cmp);
+            }
+            for (size_t i = len - 1; i >= 1; i--) {
+                swap_bytes(base, base + i * size, size);
+                generic_sift_down(base, i, 0, size, cmp);
+            }
+            return;
+        }
+
+        char *a = base + size;
+        char *b = base + len / 2 * size;
+        char *c = base + (len - 1) * size;
+        char *m;
+        if (cmp(a, b) < 0) {
+            m = cmp(b, c) < 0 ? b : (cmp(a, c) < 0 ? c : a);
+        } else {
+            m = cmp(a, c) < 0 ? a : (cmp(b, c) < 0 ? c : b);
+        }
+        swap_bytes(base, m, size);
+
+        size_t i = 0, j = len;
+        for (;;) {
+            while (cmp(base + ++i * size, base) < 0) {
+                if (i == len - 1) {
+                    break;
+                }
+            }
+            while (cmp(base, base + --j * size) < 0);
+            if (i >= j) {
+                break;
+            }
+            swap_bytes(base + i * size, base + j * size, size);
+        }
+        swap_bytes(base, base + j * size, size);
+
+        if (j < len - j - 1) {
+            generic_sort_bytes(base, j, size, depth_limit, cmp);
+            base += (j + 1) * size;
+            len -= j + 1;
+        } else {
+            generic_sort_bytes(base + (j + 1) * size, len - j - 1, size,
+                               depth_limit, cmp);
+            len = j;
+        }
+    }
+
+    for (size_t i = 1; i < len; i++) {
+        for (size_t j = i;
+                j > 0 && cmp(base + (j - 1) * size, base + j * size) > 0; j--) {
+            swap_bytes(base + (j - 1) * size, base + j * size, size);
+        }
+    }
+}
+
+void generic_sort(void *base, size_t count, size_t size,
+                  int (*cmp)(const void *, const void *))
+{
+    uintptr_t addr = (uintptr_t) base;
+
+    if (size == sizeof(generic_word32)
+            && addr % _Alignof(generic_word32) == 0) {
+        generic_sort_32(base, count, cmp);
+    } else if (size == sizeof(generic_word64)
+            && addr % _Alignof(generic_word64) == 0) {
+        generic_sort_64(base, count, cmp);
+    } else {
+        int depth_limit = 0;
+        for (size_t n = count; n > 1; n >>= 1) {
+            depth_limit += 2;
+        }
+        generic_sort_bytes(base, count, size, depth_limit, cmp);
+    }
+}
+
+/******************************************************************************/
+/*                            int-length wrappers                             */
+/******************************************************************************/
+
+/* A negative len would turn into a huge size_t, so it is caught here rather
+ * than in the _sz functions. */
+
+void insertion_sort(int *arr, int len)
+{
+    assert(len >= 0);
+    insertion_sort_sz(arr, len);
+}
+
+void selection_sort(int *arr, int len)
+{
+    assert(len >= 0);
+    selection_sort_sz(arr, len);
+}
+
+void bubble_sort(int *arr, int len)
+{
+    assert(len >= 0);
+    bubble_sort_sz(arr, len);
+}
+
+void merge_sort(int *arr, int len)
+{
+    assert(len >= 0);
+    merge_sort_sz(arr, len);
+}
+
+void merge_sort_bottom_up(int *arr, int len)
+{
+    assert(len >= 0);
+    merge_sort_bottom_up_sz(arr, len);
+}
+
+void merge_sort_in_place(int *arr, int len)
+{
+    assert(len >= 0);
+    merge_sort_in_place_sz(arr, len);
+}
+
+void parallel_merge_sort(int *arr, int len, int nthreads)
+{
+    assert(len >= 0);
+    parallel_merge_sort_sz(arr, len, nthreads);
+}
+
+void tim_sort(int *arr, int len)
+{
+    assert(len >= 0);
+    tim_sort_sz(arr, len);
+}
+
+void quick_sort(int *arr, int len)
+{
+    assert(len >= 0);
+    quick_sort_sz(arr, len);
+}
+
+void block_quick_sort(int *arr, int len)
+{
+    assert(len >= 0);
+    block_quick_sort_sz(arr, len);
+}
+
+void quick_sort_3way(int *arr, int len)
+{
+    assert(len >= 0);
+    quick_sort_3way_sz(arr, len);
+}
+
+void heap_sort(int *arr, int len)
+{
+    assert(len >= 0);
+    heap_sort_sz(arr, len);
+}
+
+void heap_sort_bottom_up(int *arr, int len)
+{
+    assert(len >= 0);
+    heap_sort_bottom_up_sz(arr, len);
+}
+
+void heap_sort_dary(int *arr, int len)
+{
+    assert(len >= 0);
+    heap_sort_dary_sz(arr, len);
+}
+
+void radix_sort(int *arr, int len)
+{
+    assert(len >= 0);
+    radix_sort_sz(arr, len);
+}
+
+void counting_sort(int *arr, int len)
+{
+    assert(len >= 0);
+    counting_sort_sz(arr, len);
+}
+
+void parallel_counting_sort(int *arr, int len, int nthreads)
+{
+    assert(len >= 0);
+    parallel_counting_sort_sz(arr, len, nthreads);
+}
+
+int select_nth(int *arr, int len, int k)
+{
+    assert(len >= 0 && k >= 0 && k < len);
+    return select_nth_sz(arr, len, k);
+}
+
+void partial_sort(int *arr, int len, int k)
+{
+    assert(len >= 0);
+    if (k > 0) {
+        partial_sort_sz(arr, len, k);
+    }
+}
+
+int top_k(const int *arr, int len, int k, int *out)
+{
+    assert(len >= 0 && k >= 0);
+    return top_k_sz(arr, len, k, out);
+}
+
+void string_sort(char **strs, int len)
+{
+    assert(len >= 0);
+    string_sort_sz(strs, len);
+}
+
+void sort_auto(int *arr, int len)
+{
+    assert(len >= 0);
+    sort_auto_sz(arr, len);
 }
@@ -1,6 +1,8 @@
 #ifndef SORT_H_
 #define SORT_H_
 
+#include <stddef.h>
+
 void insertion_sort(int *arr, int len);
 
 void selection_sort(int *arr, int len);
@@ -9,8 +11,181 @@ void bubble_sort(int *arr, int len);
 
 void merge_sort(int *arr, int len);
 
+/* stable, iterative merge sort that alternates between `arr` and a scratch
+ * buffer on every pass */
+void merge_sort_bottom_up(int *arr, int len);
+
+/* stable merge sort with only O(sqrt(len)) extra memory. Long runs are
+ * merged in blocks of sqrt(len), in O(n log n) time overall; on random ints
+ * it takes about 1.2-1.4 times as long as merge_sort. */
+void merge_sort_in_place(int *arr, int len);
+
+/* merge sort on `nthreads` threads; the halves are sorted as separate tasks
+ * and large merges are split by co-ranking */
+void parallel_merge_sort(int *arr, int len, int nthreads);
+
+/* adaptive, stable merge sort in the style of Timsort: merges the runs
+ * already present in the input and runs in near-linear time on nearly sorted
+ * data */
+void tim_sort(int *arr, int len);
+
 void quick_sort(int *arr, int len);
 
+/* quick sort with a branchless block partition (BlockQuicksort) */
+void block_quick_sort(int *arr, int len);
+
+/* quick sort with a three-way partition that groups keys equal to the pivot;
+ * runs in O(n log k) for k distinct keys */
+void quick_sort_3way(int *arr, int len);
+
 void heap_sort(int *arr, int len);
 
+/* heap sort with Floyd's bottom-up sift-down, about half the comparisons */
+void heap_sort_bottom_up(int *arr, int len);
+
+/* heap sort on a 4-ary heap, whose siblings share cache lines */
+void heap_sort_dary(int *arr, int len);
+
+/* LSD radix sort on bytes; negative numbers are handled */
+void radix_sort(int *arr, int len);
+
+/* counting sort: counts how often every value occurs, in O(len + range) time
+ * where range = max - min + 1. Arrays with fewer than two elements per value in
+ * their range are radix sorted instead. */
+void counting_sort(int *arr, int len);
+
+/* counting sort on `nthreads` threads, which count their parts of the array
+ * into histograms of their own and then merge them */
+void parallel_counting_sort(int *arr, int len, int nthreads);
+
+/* select_nth: rearranges arr so that arr[k] is the value it would have if
+ * arr were sorted, with no larger values before it and no smaller ones after.
+ * Runs in linear time, also in the worst case. k must be in [0, len).
+ *
+ * return: arr[k]
+ */
+int select_nth(int *arr, int len, int k);
+
+/* partial_sort: moves the k smallest values, sorted, to arr[0..k). The order
+ * of the rest is unspecified. */
+void partial_sort(int *arr, int len, int k);
+
+/* A streaming top-k: keeps the k smallest values pushed into it in a bounded
+ * heap, so that n pushes take O(n log k) time and O(k) memory. */
+struct topk;
+
+/* topk_create: a topk of the k >= 0 smallest values, NULL if out of memory */
+struct topk *topk_create(int k);
+
+void topk_free(struct topk *t);
+
+void topk_push(struct topk *t, int x);
+
+/* topk_result: writes the values kept so far to `out` in ascending order and
+ * returns how many there are, i.e. min(k, number of pushes) */
+int topk_result(struct topk *t, int *out);
+
+/* top_k: the k smallest values of arr, in ascending order, through the heap of
+ * a topk built in `out`, so it allocates nothing. Returns min(k, len). */
+int top_k(const int *arr, int len, int k, int *out);
+
+/* sorts C strings in the order of strcmp with a multikey quicksort. To sort
+ * records by a string key, use STRING_SORT_DEFINE in sort-template.h */
+void string_sort(char **strs, int len);
+
+/* sorts `count` elements of `size` bytes each, in the same way as qsort. For
+ * an inlined comparison, generate a specialized sort with sort-template.h */
+void generic_sort(void *base, size_t count, size_t size,
+                  int (*cmp)(const void *, const void *));
+
+/* sort_auto: sorts with whichever algorithm suits the input, judged from a
+ * cheap look at it. Sorted arrays are left alone and reversed ones are
+ * reversed, nearly sorted small arrays get insertion sort, and arrays made of
+ * runs get tim sort. Arrays whose range of values is small for their
+ * length get counting sort, and the rest get radix sort if they are large and
+ * quick sort if they are small. */
+void sort_auto(int *arr, int len);
+
+/* the algorithms sort_auto chooses from */
+enum sort_auto_choice {
+    SORT_AUTO_NONE,    /* the array was already sorted */
+    SORT_AUTO_REVERSE, /* the array was in descending order */
+    SORT_AUTO_INSERTION,
+    SORT_AUTO_TIM,
+    SORT_AUTO_COUNTING,
+    SORT_AUTO_RADIX,
+    SORT_AUTO_QUICK,
+    SORT_AUTO_QUICK_3WAY,
+    N_SORT_AUTO,
+};
+
+/* names of the choices, for printing */
+extern const char *const SORT_AUTO_NAMES[N_SORT_AUTO];
+
+/* what sort_auto found out about its input and what it chose. Features that
+ * the choice did not depend on are not computed; the fractions are then -1,
+ * and range is 0. */
+struct sort_auto_stats {
+    size_t len;
+    double runs;     /* the fraction of sampled windows that are runs */
+    double descents; /* the fraction of sampled neighbours out of order */
+    double distinct; /* the fraction of distinct values in a small sample */
+    int min;
+    int max;
+    size_t range;    /* max - min + 1 */
+    enum sort_auto_choice choice;
+};
+
+/* sort_auto_debug: sort_auto that also reports its decision in *stats */
+void sort_auto_debug(int *arr, size_t len, struct sort_auto_stats *stats);
+
+/* Variants of the functions above with size_t lengths and indices, for arrays
+ * of more than INT_MAX elements such as large memory-mapped files. The int
+ * versions are wrappers around these, and assert that len is not negative. */
+
+void insertion_sort_sz(int *arr, size_t len);
+
+void selection_sort_sz(int *arr, size_t len);
+
+void bubble_sort_sz(int *arr, size_t len);
+
+void merge_sort_sz(int *arr, size_t len);
+
+void merge_sort_bottom_up_sz(int *arr, size_t len);
+
+void merge_sort_in_place_sz(int *arr, size_t len);
+
+void parallel_merge_sort_sz(int *arr, size_t len, int nthreads);
+
+void tim_sort_sz(int *arr, size_t len);
+
+void quick_sort_sz(int *arr, size_t len);
+
+void block_quick_sort_sz(int *arr, size_t len);
+
+void quick_sort_3way_sz(int *arr, size_t len);
+
+void heap_sort_sz(int *arr, size_t len);
+
+void heap_sort_bottom_up_sz(int *arr, size_t len);
+
+void heap_sort_dary_sz(int *arr, size_t len);
+
+void radix_sort_sz(int *arr, size_t len);
+
+void counting_sort_sz(int *arr, size_t len);
+
+void parallel_counting_sort_sz(int *arr, size_t len, int nthreads);
+
+int select_nth_sz(int *arr, size_t len, size_t k);
+
+void partial_sort_sz(int *arr, size_t len, size_t k);
+
+/* k stays an int: the result and the heap behind it are k ints */
+int top_k_sz(const int *arr, size_t len, int k, int *out);
+
+void string_sort_sz(char **strs, size_t len);
+
+void sort_auto_sz(int *arr, size_t len);
+
 #endif
@@ -0,0 +1,246 @@
+/* implementation of the thread-pool module */
+
+#include "thread-pool.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* the capacity of each worker's deque; spawning into a full deque runs the
+ * task inline instead */
+#define DEQUE_CAP 1024
+
+struct task {
+    void (*fn)(void *);
+    void *arg;
+    struct tpool_join *join;
+};
+
+/* a bounded double-ended queue of tasks. `top` and `bottom` only ever grow and
+ * are reduced modulo DEQUE_CAP when indexing */
+struct deque {
+    pthread_mutex_t lock;
+    unsigned top;    /* the oldest task, taken by thieves */
+    unsigned bottom; /* one past the newest task, taken by the owner */
+    struct task tasks[DEQUE_CAP];
+};
+
+struct worker {
+    struct tpool *pool;
+    unsigned seed; /* state for picking a random victim to steal from */
+    pthread_t thread;
+    struct deque deque;
+};
+
+/* internal representation of a pool */
+struct tpool {
+    int nthreads;
+    struct worker *workers; /* workers[0] is the thread calling tpool_run */
+    pthread_mutex_t lock;   /* protects `active` and `shutdown` */
+    pthread_cond_t wake;    /* signaled when `active` or `shutdown` changes */
+    bool active;            /* whether a tpool_run is in progress */
+    bool shutdown;          /* whether the workers should exit */
+};
+
+/* the worker the current thread is acting as, NULL outside of the pool */
+static _Thread_local struct worker *self = NULL;
+
+static bool deque_push(struct deque *d, struct task *t)
+{
+    bool pushed = false;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom - d->top < DEQUE_CAP) {
+        d->tasks[d->bottom++ % DEQUE_CAP] = *t;
+        pushed = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+
+    return pushed;
+}
+
+static bool deque_pop(struct deque *d, struct task *t)
+{
+    bool popped = false;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom != d->top) {
+        *t = d->tasks[--d->bottom % DEQUE_CAP];
+        popped = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+
+    return popped;
+}
+
+static bool deque_steal(struct deque *d, struct task *t)
+{
+    bool stolen = false;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom != d->top) {
+        *t = d->tasks[d->top++ % DEQUE_CAP];
+        stolen = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+
+    return stolen;
+}
+
+static void run_task(struct task *t)
+{
+    t->fn(t->arg);
+    atomic_fetch_sub(&t->join->pending, 1);
+}
+
+/* take the newest task of our own deque, or steal the oldest task of another
+ * worker's deque, starting from a random victim */
+static bool find_task(struct worker *w, struct task *t)
+{
+    if (deque_pop(&w->deque, t)) {
+        return true;
+    }
+
+    struct tpool *pool = w->pool;
+    int n = pool->nthreads;
+    int start = rand_r(&w->seed) % n;
+
+    for (int i = 0; i < n; i++) {
+        struct worker *victim = &pool->workers[(start + i) % n];
+        if (victim != w && deque_steal(&victim->deque, t)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void *worker_main(void *arg)
+{
+    struct worker *w = arg;
+    struct tpool *pool = w->pool;
+    self = w;
+
+    for (;;) {
+        struct task t;
+        if (find_task(w, &t)) {
+            run_task(&t);
+            continue;
+        }
+
+        /* sleep while there is no tpool_run in progress */
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->active && !pool->shutdown) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        bool shutdown = pool->shutdown;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (shutdown) {
+            return NULL;
+        }
+        sched_yield();
+    }
+}
+
+struct tpool *tpool_create(int nthreads)
+{
+    assert(nthreads >= 1);
+
+    struct tpool *pool = malloc(sizeof(*pool));
+    pool->nthreads = nthreads;
+    pool->workers = malloc(nthreads * sizeof(pool->workers[0]));
+    pool->active = false;
+    pool->shutdown = false;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    for (int i = 0; i < nthreads; i++) {
+        struct worker *w = &pool->workers[i];
+        w->pool = pool;
+        w->seed = i + 1;
+        w->deque.top = 0;
+        w->deque.bottom = 0;
+        pthread_mutex_init(&w->deque.lock, NULL);
+    }
+
+    for (int i = 1; i < nthreads; i++) {
+        struct worker *w = &pool->workers[i];
+        pthread_create(&w->thread, NULL, worker_main, w);
+    }
+
+    return pool;
+}
+
+void tpool_free(struct tpool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->nthreads; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    for (int i = 0; i < pool->nthreads; i++) {
+        pthread_mutex_destroy(&pool->workers[i].deque.lock);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    free(pool->workers);
+    free(pool);
+}
+
+void tpool_run(struct tpool *pool, void (*fn)(void *arg), void *arg)
+{
+    assert(self == NULL && "tpool_run cannot be nested");
+
+    struct tpool_join join = { 0 };
+    self = &pool->workers[0];
+
+    pthread_mutex_lock(&pool->lock);
+    pool->active = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    tpool_spawn(pool, &join, fn, arg);
+    tpool_wait(pool, &join);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->active = false;
+    pthread_mutex_unlock(&pool->lock);
+
+    self = NULL;
+}
+
+void tpool_spawn(struct tpool *pool, struct tpool_join *join,
+                 void (*fn)(void *arg), void *arg)
+{
+    assert(self != NULL && self->pool == pool);
+    (void) pool;
+
+    struct task t = { .fn = fn, .arg = arg, .join = join };
+    atomic_fetch_add(&join->pending, 1);
+
+    if (!deque_push(&self->deque, &t)) {
+        run_task(&t);
+    }
+}
+
+void tpool_wait(struct tpool *pool, struct tpool_join *join)
+{
+    assert(self != NULL && self->pool == pool);
+    (void) pool;
+
+    while (atomic_load(&join->pending) > 0) {
+        struct task t;
+        if (find_task(self, &t)) {
+            run_task(&t);
+        } else {
+            sched_yield();
+        }
+    }
+}
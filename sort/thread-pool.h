@@ -0,0 +1,59 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <stdatomic.h>
+
+/* A fork-join pool of pthreads. Every worker owns a deque of tasks: it pushes
+ * and pops its own tasks at the bottom, and idle workers steal from the top of
+ * other workers' deques. */
+struct tpool;
+
+/* a join counter: the number of spawned tasks that have not yet finished */
+struct tpool_join {
+    atomic_int pending;
+};
+
+/* tpool_create: create a new pool
+ *
+ * nthreads: the total number of threads working on a task, including the
+ *           thread that calls tpool_run. nthreads - 1 threads are started.
+ * return: pointer to the newly created pool
+ */
+struct tpool *tpool_create(int nthreads);
+
+/* tpool_free: stop all workers and free the pool
+ *
+ * pool: the pool to be freed
+ */
+void tpool_free(struct tpool *pool);
+
+/* tpool_run: run fn(arg) on the pool and return once it and every task it
+ * spawned have finished. The calling thread takes part as a worker.
+ *
+ * pool: pointer to the pool
+ * fn: the root task
+ * arg: argument passed to fn
+ */
+void tpool_run(struct tpool *pool, void (*fn)(void *arg), void *arg);
+
+/* tpool_spawn: schedule fn(arg) to run, possibly on another thread. May only
+ * be called from a task running on the pool. `arg` must stay valid until
+ * tpool_wait on `join` returns.
+ *
+ * pool: pointer to the pool
+ * join: join counter to be decremented once fn finishes
+ * fn: the task
+ * arg: argument passed to fn
+ */
+void tpool_spawn(struct tpool *pool, struct tpool_join *join,
+                 void (*fn)(void *arg), void *arg);
+
+/* tpool_wait: wait until every task spawned against `join` has finished. The
+ * waiting thread runs other tasks in the meantime.
+ *
+ * pool: pointer to the pool
+ * join: the join counter to wait for
+ */
+void tpool_wait(struct tpool *pool, struct tpool_join *join);
+
+#endif